@@ -0,0 +1,154 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Tiled Cholesky factorization with dependent tasks:
+// cholesky [tiles] [tile size]
+
+#include "common.h"
+#include <math.h>
+
+static void potrf(double *a, long bs) {
+  for (long k = 0; k < bs; k++) {
+    a[k * bs + k] = sqrt(a[k * bs + k]);
+    for (long i = k + 1; i < bs; i++)
+      a[i * bs + k] /= a[k * bs + k];
+    for (long j = k + 1; j < bs; j++)
+      for (long i = j; i < bs; i++)
+        a[i * bs + j] -= a[i * bs + k] * a[j * bs + k];
+  }
+}
+
+// b = b * inverse(transpose(lower(a)))
+static void trsm(const double *a, double *b, long bs) {
+  for (long i = 0; i < bs; i++)
+    for (long j = 0; j < bs; j++) {
+      double v = b[i * bs + j];
+      for (long k = 0; k < j; k++)
+        v -= b[i * bs + k] * a[j * bs + k];
+      b[i * bs + j] = v / a[j * bs + j];
+    }
+}
+
+// c = c - a * transpose(b)
+static void gemm(const double *a, const double *b, double *c, long bs) {
+  for (long i = 0; i < bs; i++)
+    for (long j = 0; j < bs; j++) {
+      double v = c[i * bs + j];
+      for (long k = 0; k < bs; k++)
+        v -= a[i * bs + k] * b[j * bs + k];
+      c[i * bs + j] = v;
+    }
+}
+
+int main(int argc, char *argv[]) {
+  long nt = app_arg(argc, argv, 1, 4);
+  long bs = app_arg(argc, argv, 2, 16);
+  long n = nt * bs;
+  double **tile = malloc(sizeof(double *) * nt * nt);
+  double *orig = malloc(sizeof(double) * n * n);
+
+  // Symmetric and diagonally dominant, thus positive definite.
+  for (long i = 0; i < n; i++)
+    for (long j = 0; j <= i; j++) {
+      double v = i == j ? n : (double)((i * 7 + j * 13) % 10) / 10.0;
+      orig[i * n + j] = orig[j * n + i] = v;
+    }
+  for (long ti = 0; ti < nt; ti++)
+    for (long tj = 0; tj < nt; tj++) {
+      double *t = malloc(sizeof(double) * bs * bs);
+      for (long i = 0; i < bs; i++)
+        for (long j = 0; j < bs; j++)
+          t[i * bs + j] = orig[(ti * bs + i) * n + tj * bs + j];
+      tile[ti * nt + tj] = t;
+    }
+
+  double start = omp_get_wtime();
+  #pragma omp parallel
+  #pragma omp single
+  for (long k = 0; k < nt; k++) {
+    double *akk = tile[k * nt + k];
+    #pragma omp task depend(inout: akk[0])
+    potrf(akk, bs);
+    for (long i = k + 1; i < nt; i++) {
+      double *aik = tile[i * nt + k];
+      #pragma omp task depend(in: akk[0]) depend(inout: aik[0])
+      trsm(akk, aik, bs);
+    }
+    for (long i = k + 1; i < nt; i++) {
+      double *aik = tile[i * nt + k];
+      double *aii = tile[i * nt + i];
+      #pragma omp task depend(in: aik[0]) depend(inout: aii[0])
+      gemm(aik, aik, aii, bs);
+      for (long j = k + 1; j < i; j++) {
+        double *ajk = tile[j * nt + k];
+        double *aij = tile[i * nt + j];
+        #pragma omp task depend(in: aik[0], ajk[0]) depend(inout: aij[0])
+        gemm(aik, ajk, aij, bs);
+      }
+    }
+  }
+  double seconds = omp_get_wtime() - start;
+
+  // Check lower(L * transpose(L)) against the input.
+  double error = 0.0;
+  for (long i = 0; i < n; i++)
+    for (long j = 0; j <= i; j++) {
+      double v = 0.0;
+      for (long k = 0; k <= j; k++)
+        v += tile[(i / bs) * nt + k / bs][(i % bs) * bs + k % bs] *
+             tile[(j / bs) * nt + k / bs][(j % bs) * bs + k % bs];
+      error = fmax(error, fabs(v - orig[i * n + j]) / n);
+    }
+
+  for (long t = 0; t < nt * nt; t++)
+    free(tile[t]);
+  free(tile);
+  free(orig);
+  return app_report("cholesky", error < 1e-10, seconds);
+}
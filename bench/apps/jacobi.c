@@ -0,0 +1,103 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Jacobi iteration for the Laplace equation on an n x n grid with a
+// 5-point stencil: jacobi [n] [iterations]
+
+#include "common.h"
+#include <string.h>
+
+static void init(double *u, long n) {
+  memset(u, 0, sizeof(double) * n * n);
+  for (long j = 0; j < n; j++)
+    u[j] = 1.0;
+}
+
+static double sweep(const double *u, double *unew, long n, int parallel) {
+  double residual = 0.0;
+  #pragma omp parallel for reduction(+:residual) if(parallel)
+  for (long i = 1; i < n - 1; i++)
+    for (long j = 1; j < n - 1; j++) {
+      double v = 0.25 * (u[(i - 1) * n + j] + u[(i + 1) * n + j] +
+                         u[i * n + j - 1] + u[i * n + j + 1]);
+      residual += (v - u[i * n + j]) * (v - u[i * n + j]);
+      unew[i * n + j] = v;
+    }
+  return residual;
+}
+
+static double *solve(long n, long iterations, int parallel, double *seconds) {
+  double *u = malloc(sizeof(double) * n * n);
+  double *unew = malloc(sizeof(double) * n * n);
+  init(u, n);
+  init(unew, n);
+  double start = omp_get_wtime();
+  for (long it = 0; it < iterations; it++) {
+    double *tmp;
+    sweep(u, unew, n, parallel);
+    tmp = u;
+    u = unew;
+    unew = tmp;
+  }
+  *seconds = omp_get_wtime() - start;
+  free(unew);
+  return u;
+}
+
+int main(int argc, char *argv[]) {
+  long n = app_arg(argc, argv, 1, 64);
+  long iterations = app_arg(argc, argv, 2, 20);
+  double seconds, serial_seconds;
+  double *u = solve(n, iterations, 1, &seconds);
+  double *ref = solve(n, iterations, 0, &serial_seconds);
+  int ok = memcmp(u, ref, sizeof(double) * n * n) == 0;
+  free(u);
+  free(ref);
+  return app_report("jacobi", ok, seconds);
+}
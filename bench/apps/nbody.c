@@ -0,0 +1,129 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Direct N-body simulation; the forces are computed in a worksharing loop
+// and the energy with a reduction: nbody [bodies] [steps]
+
+#include "common.h"
+#include <math.h>
+#include <string.h>
+
+struct body {
+  double x[3], v[3], m;
+};
+
+static void init(struct body *b, long n) {
+  for (long i = 0; i < n; i++) {
+    for (int d = 0; d < 3; d++) {
+      b[i].x[d] = (double)((i * 37 + d * 101) % 1000) / 100.0;
+      b[i].v[d] = 0.0;
+    }
+    b[i].m = 1.0 + (double)(i % 10) / 10.0;
+  }
+}
+
+static double step(struct body *b, double (*f)[3], long n, int parallel) {
+  const double dt = 0.001, eps = 0.01;
+  double energy = 0.0;
+  #pragma omp parallel if(parallel)
+  {
+    #pragma omp for schedule(static)
+    for (long i = 0; i < n; i++) {
+      double a[3] = {0.0, 0.0, 0.0};
+      for (long j = 0; j < n; j++) {
+        double d[3], r2 = eps;
+        for (int k = 0; k < 3; k++) {
+          d[k] = b[j].x[k] - b[i].x[k];
+          r2 += d[k] * d[k];
+        }
+        double s = b[j].m / (r2 * sqrt(r2));
+        for (int k = 0; k < 3; k++)
+          a[k] += s * d[k];
+      }
+      for (int k = 0; k < 3; k++)
+        f[i][k] = a[k];
+    }
+    #pragma omp for schedule(static) reduction(+:energy)
+    for (long i = 0; i < n; i++) {
+      for (int k = 0; k < 3; k++) {
+        b[i].v[k] += dt * f[i][k];
+        b[i].x[k] += dt * b[i].v[k];
+      }
+      energy += 0.5 * b[i].m * (b[i].v[0] * b[i].v[0] + b[i].v[1] * b[i].v[1] +
+                                b[i].v[2] * b[i].v[2]);
+    }
+  }
+  return energy;
+}
+
+static struct body *simulate(long n, long steps, int parallel, double *energy,
+                             double *seconds) {
+  struct body *b = malloc(sizeof(struct body) * n);
+  double (*f)[3] = malloc(sizeof(double[3]) * n);
+  init(b, n);
+  double start = omp_get_wtime();
+  for (long s = 0; s < steps; s++)
+    *energy = step(b, f, n, parallel);
+  *seconds = omp_get_wtime() - start;
+  free(f);
+  return b;
+}
+
+int main(int argc, char *argv[]) {
+  long n = app_arg(argc, argv, 1, 256);
+  long steps = app_arg(argc, argv, 2, 5);
+  double energy, ref_energy, seconds, serial_seconds;
+  struct body *b = simulate(n, steps, 1, &energy, &seconds);
+  struct body *ref = simulate(n, steps, 0, &ref_energy, &serial_seconds);
+  int ok = memcmp(b, ref, sizeof(struct body) * n) == 0 &&
+           fabs(energy - ref_energy) <= 1e-9 * fabs(ref_energy);
+  free(b);
+  free(ref);
+  return app_report("nbody", ok, seconds);
+}
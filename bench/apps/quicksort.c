@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Quicksort with a task for each partition above a cutoff:
+// quicksort [elements] [cutoff]
+
+#include "common.h"
+
+static void swap(long *a, long *b) {
+  long t = *a;
+  *a = *b;
+  *b = t;
+}
+
+static void sort(long *a, long n, long cutoff) {
+  if (n < 2)
+    return;
+  long pivot = a[n / 2], i = 0, j = n - 1;
+  while (i <= j) {
+    while (a[i] < pivot)
+      i++;
+    while (a[j] > pivot)
+      j--;
+    if (i <= j)
+      swap(&a[i++], &a[j--]);
+  }
+  if (n > cutoff) {
+    #pragma omp task
+    sort(a, j + 1, cutoff);
+    #pragma omp task
+    sort(a + i, n - i, cutoff);
+  } else {
+    sort(a, j + 1, cutoff);
+    sort(a + i, n - i, cutoff);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  long n = app_arg(argc, argv, 1, 100000);
+  long cutoff = app_arg(argc, argv, 2, 1000);
+  long *a = malloc(sizeof(long) * n);
+  unsigned long x = 42;
+  for (long i = 0; i < n; i++) {
+    x = x * 6364136223846793005UL + 1442695040888963407UL;
+    a[i] = (long)(x >> 33);
+  }
+
+  double start = omp_get_wtime();
+  // The tasks complete at the implicit barrier.
+  #pragma omp parallel
+  #pragma omp single
+  sort(a, n, cutoff);
+  double seconds = omp_get_wtime() - start;
+
+  int ok = 1;
+  for (long i = 1; i < n; i++)
+    if (a[i - 1] > a[i])
+      ok = 0;
+  free(a);
+  return app_report("quicksort", ok, seconds);
+}
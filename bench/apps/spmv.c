@@ -0,0 +1,129 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Repeated sparse matrix-vector products with a banded matrix in CSR
+// format: spmv [rows] [iterations]
+
+#include "common.h"
+#include <string.h>
+
+#define NNZ_PER_ROW 9
+
+struct csr {
+  long rows;
+  long *start;
+  long *col;
+  double *val;
+};
+
+static void build(struct csr *a, long rows) {
+  a->rows = rows;
+  a->start = malloc(sizeof(long) * (rows + 1));
+  a->col = malloc(sizeof(long) * rows * NNZ_PER_ROW);
+  a->val = malloc(sizeof(double) * rows * NNZ_PER_ROW);
+  long nnz = 0;
+  for (long i = 0; i < rows; i++) {
+    a->start[i] = nnz;
+    for (long k = -NNZ_PER_ROW / 2; k <= NNZ_PER_ROW / 2; k++) {
+      // Every row couples to neighbours near and far away.
+      long j = (i + k * (k < 0 ? 1 : 97)) % rows;
+      if (j < 0)
+        j += rows;
+      a->col[nnz] = j;
+      a->val[nnz] = k == 0 ? 2.0 : -1.0 / NNZ_PER_ROW;
+      nnz++;
+    }
+  }
+  a->start[rows] = nnz;
+}
+
+static void multiply(const struct csr *a, const double *x, double *y, int parallel) {
+  #pragma omp parallel for schedule(static) if(parallel)
+  for (long i = 0; i < a->rows; i++) {
+    double sum = 0.0;
+    for (long k = a->start[i]; k < a->start[i + 1]; k++)
+      sum += a->val[k] * x[a->col[k]];
+    y[i] = sum;
+  }
+}
+
+static double *run(const struct csr *a, long iterations, int parallel, double *seconds) {
+  double *x = malloc(sizeof(double) * a->rows);
+  double *y = malloc(sizeof(double) * a->rows);
+  for (long i = 0; i < a->rows; i++)
+    x[i] = 1.0 / (i + 1);
+  double start = omp_get_wtime();
+  for (long it = 0; it < iterations; it++) {
+    double *tmp;
+    multiply(a, x, y, parallel);
+    tmp = x;
+    x = y;
+    y = tmp;
+  }
+  *seconds = omp_get_wtime() - start;
+  free(y);
+  return x;
+}
+
+int main(int argc, char *argv[]) {
+  long rows = app_arg(argc, argv, 1, 10000);
+  long iterations = app_arg(argc, argv, 2, 10);
+  struct csr a;
+  double seconds, serial_seconds;
+  build(&a, rows);
+  double *x = run(&a, iterations, 1, &seconds);
+  double *ref = run(&a, iterations, 0, &serial_seconds);
+  int ok = memcmp(x, ref, sizeof(double) * rows) == 0;
+  free(x);
+  free(ref);
+  free(a.start);
+  free(a.col);
+  free(a.val);
+  return app_report("spmv", ok, seconds);
+}
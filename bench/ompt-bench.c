@@ -0,0 +1,251 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Microbenchmarks for the OpenMP events that Archer handles. Every
+// benchmark repeats one construct and prints the time per construct and the
+// memory peak of the process:
+//
+//   ompt-bench <benchmark> [iterations]
+//
+// The number of threads is taken from OMP_NUM_THREADS.
+
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+static int counter;
+
+// Keeps the compiler from removing otherwise empty regions and tasks.
+static void __attribute__((noinline)) empty(void) {
+  __asm__ volatile("");
+}
+
+static void bench_parallel(long n) {
+  for (long i = 0; i < n; i++) {
+    #pragma omp parallel
+    empty();
+  }
+}
+
+static void bench_barrier(long n) {
+  #pragma omp parallel
+  {
+    for (long i = 0; i < n; i++) {
+      #pragma omp barrier
+    }
+  }
+}
+
+static void bench_task(long n) {
+  #pragma omp parallel
+  #pragma omp single
+  {
+    for (long i = 0; i < n; i++) {
+      #pragma omp task
+      empty();
+    }
+  }
+}
+
+static long fib(int k) {
+  long a, b;
+  if (k < 2)
+    return 1;
+  #pragma omp task shared(a)
+  a = fib(k - 1);
+  #pragma omp task shared(b)
+  b = fib(k - 2);
+  #pragma omp taskwait
+  return a + b;
+}
+
+// Number of tasks created by fib(k).
+static long fib_tasks(int k) {
+  return k < 2 ? 0 : 2 + fib_tasks(k - 1) + fib_tasks(k - 2);
+}
+
+static void bench_task_recursive(long n) {
+  #pragma omp parallel
+  #pragma omp single
+  fib((int)n);
+}
+
+static void bench_taskwait(long n) {
+  #pragma omp parallel
+  #pragma omp single
+  {
+    for (long i = 0; i < n; i++) {
+      #pragma omp task
+      counter++;
+      #pragma omp taskwait
+    }
+  }
+}
+
+static void bench_taskgroup(long n) {
+  #pragma omp parallel
+  #pragma omp single
+  {
+    for (long i = 0; i < n; i++) {
+      #pragma omp taskgroup
+      {
+        #pragma omp task
+        counter++;
+      }
+    }
+  }
+}
+
+static void bench_task_depend(long n) {
+  #pragma omp parallel
+  #pragma omp single
+  {
+    for (long i = 0; i < n; i++) {
+      #pragma omp task depend(inout: counter)
+      counter++;
+    }
+  }
+}
+
+static void bench_critical(long n) {
+  #pragma omp parallel for
+  for (long i = 0; i < n; i++) {
+    #pragma omp critical
+    counter++;
+  }
+}
+
+static void bench_lock(long n) {
+  omp_lock_t lock;
+  omp_init_lock(&lock);
+  #pragma omp parallel for
+  for (long i = 0; i < n; i++) {
+    omp_set_lock(&lock);
+    counter++;
+    omp_unset_lock(&lock);
+  }
+  omp_destroy_lock(&lock);
+}
+
+static void bench_atomic(long n) {
+  #pragma omp parallel for
+  for (long i = 0; i < n; i++) {
+    #pragma omp atomic
+    counter++;
+  }
+}
+
+static void bench_ordered(long n) {
+  #pragma omp parallel for ordered schedule(static, 1)
+  for (long i = 0; i < n; i++) {
+    #pragma omp ordered
+    counter++;
+  }
+}
+
+struct benchmark {
+  const char *name;
+  void (*run)(long);
+  long iterations;
+};
+
+static const struct benchmark benchmarks[] = {
+  {"parallel", bench_parallel, 10000},
+  {"barrier", bench_barrier, 10000},
+  {"task", bench_task, 100000},
+  {"task-recursive", bench_task_recursive, 22},
+  {"taskwait", bench_taskwait, 100000},
+  {"taskgroup", bench_taskgroup, 100000},
+  {"task-depend", bench_task_depend, 100000},
+  {"critical", bench_critical, 100000},
+  {"lock", bench_lock, 100000},
+  {"atomic", bench_atomic, 1000000},
+  {"ordered", bench_ordered, 100000},
+  {NULL, NULL, 0}
+};
+
+int main(int argc, char *argv[]) {
+  const struct benchmark *b;
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <benchmark> [iterations]\nbenchmarks:", argv[0]);
+    for (b = benchmarks; b->name; b++)
+      fprintf(stderr, " %s", b->name);
+    fprintf(stderr, "\n");
+    return 2;
+  }
+  for (b = benchmarks; b->name; b++)
+    if (!strcmp(b->name, argv[1]))
+      break;
+  if (!b->name) {
+    fprintf(stderr, "unknown benchmark %s\n", argv[1]);
+    return 2;
+  }
+
+  long n = argc > 2 ? atol(argv[2]) : b->iterations;
+  // For task-recursive the argument is the depth, count the tasks instead.
+  long ops = b->run == bench_task_recursive ? fib_tasks((int)n) : n;
+
+  // Start the threads outside of the measurement.
+  #pragma omp parallel
+  {
+  }
+
+  double start = omp_get_wtime();
+  b->run(n);
+  double end = omp_get_wtime();
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  // benchmark threads operations ns/op max-rss[KBytes]
+  printf("%s %d %ld %.1f %ld\n", b->name, omp_get_max_threads(), ops,
+         (end - start) * 1e9 / ops, usage.ru_maxrss);
+  return 0;
+}
@@ -48,18 +48,25 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "llvm/Transforms/Instrumentation.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/CaptureTracking.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/IR/CFG.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/Instructions.h"
@@ -72,6 +79,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Cloning.h"
@@ -80,14 +88,41 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "llvm/Transforms/Utils/ValueMapper.h"
 #include "archer/LinkAllPasses.h"
 
+#include <set>
+#include <tuple>
+
 using namespace llvm;
 
 #define MIN_VERSION 39
 
+static cl::opt<bool> ClOffline(
+    "archer-offline",
+    cl::desc("Log the memory accesses of parallel code for offline race "
+             "analysis instead of checking them with ThreadSanitizer"),
+    cl::Hidden, cl::init(false));
+
+static cl::opt<bool> ClStaticLoops(
+    "archer-static-loops",
+    cl::desc("Check accesses of statically scheduled worksharing loops that "
+             "are indexed by the loop variable once per chunk"),
+    cl::Hidden, cl::init(true));
+
+static cl::list<std::string> ClChanged(
+    "archer-changed",
+    cl::desc("Functions or source files changed since a baseline. Only they, "
+             "their callers and their callees are instrumented"),
+    cl::CommaSeparated, cl::Hidden);
+
+static cl::opt<std::string> ClChangedList(
+    "archer-changed-list",
+    cl::desc("File listing one changed function or source file per line, "
+             "as for -archer-changed"),
+    cl::Hidden, cl::init(""));
+
 namespace {
 
 struct InstrumentParallel : public FunctionPass {
-  InstrumentParallel() : FunctionPass(ID) { PassName = "InstrumentParallel"; }
+  InstrumentParallel() : FunctionPass(ID), Incremental(false) { PassName = "InstrumentParallel"; }
 #if LLVM_VERSION > MIN_VERSION
   StringRef getPassName() const override;
 #else
@@ -100,7 +135,14 @@ struct InstrumentParallel : public FunctionPass {
 
 private:
   std::string PassName;
+  // Whether only the functions in Selected are instrumented.
+  bool Incremental;
+  StringSet<> Selected;
+  void selectChangedFunctions(Module &M, const std::vector<std::string> &Changed);
   void setMetadata(Instruction *Inst, const char *name, const char *description);
+  void instrumentMemoryAccesses(Function &F, GlobalVariable *ompStatusGlobal);
+  void instrumentStaticLoops(Function &F);
+  void rejectUntiedTasks(Function &F);
 };
 }  // namespace
 
@@ -132,15 +174,544 @@ Pass *llvm::createInstrumentParallelPass() {
 }
 
 bool InstrumentParallel::doInitialization(Module &M) {
+  std::vector<std::string> Changed(ClChanged.begin(), ClChanged.end());
+  if (!ClChangedList.empty()) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+      MemoryBuffer::getFile(ClChangedList);
+    if (!Buffer)
+      report_fatal_error(Twine("Could not read ") + ClChangedList);
+    SmallVector<StringRef, 16> Lines;
+    (*Buffer)->getBuffer().split(Lines, '\n', -1, false);
+    for (StringRef Line : Lines) {
+      Line = Line.trim();
+      if (!Line.empty())
+        Changed.push_back(Line.str());
+    }
+  }
+
+  // An empty list means that nothing changed, not that everything did.
+  Incremental = ClChanged.getNumOccurrences() > 0 || !ClChangedList.empty();
+  if (Incremental)
+    selectChangedFunctions(M, Changed);
   return true;
 }
 
+// Whether Path names the file Suffix, which may be relative, e.g. as printed
+// by "git diff --name-only".
+static bool pathEndsWith(StringRef Path, StringRef Suffix) {
+  if (!Path.endswith(Suffix))
+    return false;
+  return Path.size() == Suffix.size() || Suffix.startswith("/") ||
+         Path[Path.size() - Suffix.size() - 1] == '/';
+}
+
+static bool isChanged(const Function &F, const std::vector<std::string> &Changed) {
+  const DISubprogram *SP = F.getSubprogram();
+  std::string File = F.getParent()->getSourceFileName();
+  if (SP)
+    File = (SP->getDirectory() + "/" + SP->getFilename()).str();
+  for (const std::string &Entry : Changed) {
+    if (F.getName() == Entry || pathEndsWith(File, Entry))
+      return true;
+    if (SP && (SP->getName() == Entry || SP->getLinkageName() == Entry))
+      return true;
+  }
+  return false;
+}
+
+// Functions that reference V, either by calling it or by passing it on,
+// e.g. an outlined region passed to __kmpc_fork_call.
+static void addUsers(Value *V, SetVector<Function *> &Users) {
+  for (User *U : V->users()) {
+    if (Instruction *I = dyn_cast<Instruction>(U))
+      Users.insert(I->getParent()->getParent());
+    else if (isa<ConstantExpr>(U))
+      addUsers(U, Users);
+  }
+}
+
+// Functions referenced by F.
+static void addCallees(Function &F, SetVector<Function *> &Callees) {
+  for (Instruction &I : instructions(F))
+    for (Value *Op : I.operands())
+      if (Function *Callee = dyn_cast<Function>(Op->stripPointerCasts()))
+        if (!Callee->isDeclaration())
+          Callees.insert(Callee);
+}
+
+// Selects the changed functions of the module together with their callers
+// and callees. The outlined regions and tasks of a selected function are
+// part of its source code, so they are selected along with it.
+void InstrumentParallel::selectChangedFunctions(Module &M, const std::vector<std::string> &Changed) {
+  SetVector<Function *> Functions;
+  for (Function &F : M)
+    if (!F.isDeclaration() && isChanged(F, Changed))
+      Functions.insert(&F);
+
+  SetVector<Function *> Neighbours;
+  for (Function *F : Functions) {
+    addUsers(F, Neighbours);
+    addCallees(*F, Neighbours);
+  }
+  Functions.insert(Neighbours.begin(), Neighbours.end());
+
+  // Functions grows while it is traversed.
+  for (unsigned i = 0; i < Functions.size(); i++) {
+    SetVector<Function *> Callees;
+    addCallees(*Functions[i], Callees);
+    for (Function *Callee : Callees)
+      if (Callee->getName().startswith(".omp"))
+        Functions.insert(Callee);
+  }
+
+  for (Function *F : Functions)
+    Selected.insert(F->getName());
+}
+
 void InstrumentParallel::setMetadata(Instruction *Inst, const char *name, const char *description) {
   LLVMContext& C = Inst->getContext();
   MDNode* N = MDNode::get(C, MDString::get(C, description));
   Inst->setMetadata(name, N);
 }
 
+// Whether bit 0 of the task flags V, which marks tied tasks, is known to be
+// clear. Clang passes the flags as a constant or, with a final clause, as a
+// select between two constants.
+static bool isUntiedFlags(Value *V) {
+  if (ConstantInt *C = dyn_cast<ConstantInt>(V))
+    return !(C->getZExtValue() & 1);
+  if (SelectInst *SI = dyn_cast<SelectInst>(V))
+    return isUntiedFlags(SI->getTrueValue()) &&
+           isUntiedFlags(SI->getFalseValue());
+  return false;
+}
+
+// The offline analyzer orders the segments of a task by the log of the thread
+// that executes it. Untied tasks may resume on another thread, which would
+// silently break that order, so they are rejected in offline mode.
+void InstrumentParallel::rejectUntiedTasks(Function &F) {
+  for (auto &BB : F)
+    for (auto &Inst : BB)
+      if (CallInst *CI = dyn_cast<CallInst>(&Inst))
+        if (Function *Callee = CI->getCalledFunction())
+          if (Callee->getName() == "__kmpc_omp_task_alloc" &&
+              CI->getNumArgOperands() >= 3 &&
+              isUntiedFlags(CI->getArgOperand(2)))
+            report_fatal_error(Twine("Untied task in ") + F.getName() +
+                               " is not supported with -archer-offline");
+}
+
+// In offline mode every load and store of parallel code that may touch
+// shared memory is preceded by a call into the Archer runtime, which logs the
+// access for the offline analyzer.
+void InstrumentParallel::instrumentMemoryAccesses(Function &F, GlobalVariable *ompStatusGlobal) {
+  Module *M = F.getParent();
+  const DataLayout &DL = M->getDataLayout();
+  IRBuilder<> IRB(M->getContext());
+  Constant *LogRead = M->getOrInsertFunction("__archer_log_read",
+                                             IRB.getVoidTy(),
+                                             IRB.getInt8PtrTy(),
+                                             IRB.getInt32Ty(),
+                                             NULL);
+  Constant *LogWrite = M->getOrInsertFunction("__archer_log_write",
+                                              IRB.getVoidTy(),
+                                              IRB.getInt8PtrTy(),
+                                              IRB.getInt32Ty(),
+                                              NULL);
+
+  SmallVector<Instruction*, 16> Accesses;
+  for (auto &BB : F) {
+    for (auto &Inst : BB) {
+      Value *Addr;
+      if (LoadInst *LI = dyn_cast<LoadInst>(&Inst)) {
+        if (LI->isAtomic() || LI->isVolatile())
+          continue;
+        Addr = LI->getPointerOperand();
+      } else if (StoreInst *SI = dyn_cast<StoreInst>(&Inst)) {
+        if (SI->isAtomic() || SI->isVolatile())
+          continue;
+        Addr = SI->getPointerOperand();
+      } else {
+        continue;
+      }
+      if (Addr == ompStatusGlobal)
+        continue;
+      // Local variables whose address never escapes cannot be shared.
+      Value *Obj = GetUnderlyingObject(Addr, DL);
+      if (isa<AllocaInst>(Obj) && !PointerMayBeCaptured(Obj, true, true))
+        continue;
+      Accesses.push_back(&Inst);
+    }
+  }
+
+  for (Instruction *Inst : Accesses) {
+    IRBuilder<> Builder(Inst);
+    bool IsWrite = isa<StoreInst>(Inst);
+    Value *Addr = IsWrite ? cast<StoreInst>(Inst)->getPointerOperand()
+                          : cast<LoadInst>(Inst)->getPointerOperand();
+    Type *OrigTy = cast<PointerType>(Addr->getType())->getElementType();
+    uint32_t Size = DL.getTypeStoreSize(OrigTy);
+    Builder.CreateCall(IsWrite ? LogWrite : LogRead,
+                       {Builder.CreatePointerCast(Addr, Builder.getInt8PtrTy()),
+                        Builder.getInt32(Size)});
+  }
+}
+
+// Static schedule without chunk size: every thread executes a single
+// contiguous chunk of iterations (kmp_sch_static in the OpenMP runtime).
+#define KMP_SCH_STATIC 34
+
+/// Returns the alloca V is loaded from if the alloca does not escape and is
+/// only written in the entry block, i.e. the loaded value is the same in
+/// every iteration of a loop.
+static AllocaInst *getInvariantAlloca(Value *V) {
+  LoadInst *LI = dyn_cast<LoadInst>(V);
+  if (!LI)
+    return nullptr;
+  AllocaInst *AI = dyn_cast<AllocaInst>(LI->getPointerOperand());
+  if (!AI)
+    return nullptr;
+  BasicBlock *Entry = &AI->getParent()->getParent()->getEntryBlock();
+  for (User *U : AI->users()) {
+    if (StoreInst *SI = dyn_cast<StoreInst>(U)) {
+      if (SI->getValueOperand() == AI || SI->getParent() != Entry)
+        return nullptr;
+    } else if (!isa<LoadInst>(U)) {
+      return nullptr;
+    }
+  }
+  return AI;
+}
+
+namespace {
+/// Array index of the form ConstOffset + VarScale * *VarOffset + Scale * iv,
+/// where iv is the iteration counter of a worksharing loop.
+struct AffineIndex {
+  int64_t Scale;
+  int64_t ConstOffset;
+  int64_t VarScale;
+  AllocaInst *VarOffset;
+};
+
+/// An access that happens in every iteration of a static worksharing loop
+/// at &Base[Index].
+struct ChunkAccess {
+  Instruction *Inst;
+  Value *Base;
+  unsigned BaseLoads;
+  bool ArrayBase;
+  AffineIndex Index;
+  /// Narrower type the index is sign or zero extended from, or nullptr. The
+  /// index wraps around in this type.
+  Type *IndexTy;
+  bool IndexSigned;
+  Type *ElemTy;
+  bool IsWrite;
+};
+}
+
+static bool matchAffine(Value *V, AllocaInst *IV, AffineIndex &R, int Depth) {
+  if (Depth > 8)
+    return false;
+  if (CastInst *CI = dyn_cast<CastInst>(V))
+    if (isa<SExtInst>(CI) || isa<ZExtInst>(CI) || isa<TruncInst>(CI))
+      return matchAffine(CI->getOperand(0), IV, R, Depth + 1);
+  if (LoadInst *LI = dyn_cast<LoadInst>(V)) {
+    Value *Ptr = LI->getPointerOperand();
+    if (Ptr == IV) {
+      R = {1, 0, 0, nullptr};
+      return true;
+    }
+    // The private copy of the loop variable is assigned once per iteration.
+    AllocaInst *AI = dyn_cast<AllocaInst>(Ptr);
+    if (!AI)
+      return false;
+    StoreInst *Def = nullptr;
+    for (User *U : AI->users()) {
+      if (StoreInst *SI = dyn_cast<StoreInst>(U)) {
+        if (Def || SI->getPointerOperand() != AI)
+          return false;
+        Def = SI;
+      } else if (!isa<LoadInst>(U)) {
+        return false;
+      }
+    }
+    return Def && matchAffine(Def->getValueOperand(), IV, R, Depth + 1);
+  }
+  BinaryOperator *BO = dyn_cast<BinaryOperator>(V);
+  if (!BO)
+    return false;
+  Value *LHS = BO->getOperand(0), *RHS = BO->getOperand(1);
+  switch (BO->getOpcode()) {
+  case Instruction::Mul: {
+    ConstantInt *C = dyn_cast<ConstantInt>(RHS);
+    if (!C) {
+      C = dyn_cast<ConstantInt>(LHS);
+      LHS = RHS;
+    }
+    if (!C || !matchAffine(LHS, IV, R, Depth + 1))
+      return false;
+    R.Scale *= C->getSExtValue();
+    R.ConstOffset *= C->getSExtValue();
+    R.VarScale *= C->getSExtValue();
+    return true;
+  }
+  case Instruction::Add:
+  case Instruction::Sub: {
+    bool Sub = BO->getOpcode() == Instruction::Sub;
+    Value *Other = RHS;
+    if (!matchAffine(LHS, IV, R, Depth + 1)) {
+      if (Sub || !matchAffine(RHS, IV, R, Depth + 1))
+        return false;
+      Other = LHS;
+    }
+    if (ConstantInt *C = dyn_cast<ConstantInt>(Other)) {
+      R.ConstOffset += Sub ? -C->getSExtValue() : C->getSExtValue();
+      return true;
+    }
+    AllocaInst *AI = getInvariantAlloca(Other);
+    if (!AI || R.VarOffset)
+      return false;
+    R.VarOffset = AI;
+    R.VarScale = Sub ? -1 : 1;
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+/// Returns the loop-invariant base of a pointer: an argument, a global, an
+/// alloca or a value loaded (through at most two levels) from an invariant
+/// alloca. The number of loads is stored in Loads.
+static Value *getInvariantBase(Value *V, unsigned &Loads) {
+  Loads = 0;
+  while (LoadInst *LI = dyn_cast<LoadInst>(V)) {
+    if (++Loads > 2)
+      return nullptr;
+    V = LI->getPointerOperand();
+    if (getInvariantAlloca(LI))
+      return V;
+  }
+  if (isa<Argument>(V) || isa<GlobalVariable>(V) || isa<AllocaInst>(V))
+    return V;
+  return nullptr;
+}
+
+/// Classify the accesses of statically scheduled worksharing loops that are
+/// indexed by the loop variable. Each thread touches a contiguous range of
+/// such an array, so the accesses are checked once per chunk with
+/// __tsan_read_range/__tsan_write_range and the per-iteration checks are
+/// disabled with nosanitize metadata.
+void InstrumentParallel::instrumentStaticLoops(Function &F) {
+  Module *M = F.getParent();
+  const DataLayout &DL = M->getDataLayout();
+  SmallVector<CallInst*, 4> Inits;
+  for (auto &BB : F)
+    for (auto &Inst : BB)
+      if (CallInst *CI = dyn_cast<CallInst>(&Inst))
+        if (Function *Callee = CI->getCalledFunction())
+          if (Callee->getName().startswith("__kmpc_for_static_init_") &&
+              CI->getNumArgOperands() >= 6)
+            Inits.push_back(CI);
+  if (Inits.empty())
+    return;
+
+  DominatorTree DT(F);
+  IRBuilder<> IRB(M->getContext());
+  Type *IntptrTy = DL.getIntPtrType(M->getContext());
+  Constant *ReadRange = M->getOrInsertFunction("__tsan_read_range",
+                                               IRB.getVoidTy(),
+                                               IRB.getInt8PtrTy(),
+                                               IntptrTy,
+                                               NULL);
+  Constant *WriteRange = M->getOrInsertFunction("__tsan_write_range",
+                                                IRB.getVoidTy(),
+                                                IRB.getInt8PtrTy(),
+                                                IntptrTy,
+                                                NULL);
+
+  for (CallInst *Init : Inits) {
+    ConstantInt *Sched = dyn_cast<ConstantInt>(Init->getArgOperand(2));
+    if (!Sched || Sched->getSExtValue() != KMP_SCH_STATIC)
+      continue;
+    Value *LB = Init->getArgOperand(4), *UB = Init->getArgOperand(5);
+
+    // Clang copies the lower bound of the chunk into the iteration counter
+    // (after clamping the upper bound) and increments it in the latch.
+    StoreInst *IVInit = nullptr;
+    for (User *U : LB->users())
+      if (LoadInst *LI = dyn_cast<LoadInst>(U))
+        for (User *LU : LI->users())
+          if (StoreInst *SI = dyn_cast<StoreInst>(LU))
+            if (isa<AllocaInst>(SI->getPointerOperand()))
+              IVInit = SI;
+    if (!IVInit)
+      continue;
+    AllocaInst *IV = cast<AllocaInst>(IVInit->getPointerOperand());
+    StoreInst *Latch = nullptr;
+    bool Simple = true;
+    for (User *U : IV->users())
+      if (StoreInst *SI = dyn_cast<StoreInst>(U))
+        if (SI != IVInit) {
+          Simple &= !Latch;
+          Latch = SI;
+        }
+    BasicBlock *Header = IVInit->getParent()->getSingleSuccessor();
+    if (!Simple || !Latch || !Header)
+      continue;
+
+    // The natural loop of the back edge from the latch to the header.
+    SmallPtrSet<BasicBlock*, 16> Body;
+    SmallVector<BasicBlock*, 16> Work;
+    Body.insert(Header);
+    Work.push_back(Latch->getParent());
+    while (!Work.empty()) {
+      BasicBlock *BB = Work.pop_back_val();
+      if (!Body.insert(BB).second)
+        continue;
+      for (BasicBlock *Pred : predecessors(BB))
+        Work.push_back(Pred);
+    }
+
+    // Synchronization or calls inside of the loop could order the accesses
+    // of an iteration differently than the chunk start.
+    bool Clean = true;
+    for (BasicBlock *BB : Body)
+      for (auto &Inst : *BB) {
+        if (isa<MemIntrinsic>(Inst))
+          Clean = false;
+        else if (auto *CI = dyn_cast<CallInst>(&Inst))
+          Clean &= isa<IntrinsicInst>(CI) || CI->onlyReadsMemory();
+        else if (Inst.isAtomic())
+          Clean = false;
+      }
+    if (!Clean)
+      continue;
+
+    SmallVector<ChunkAccess, 16> Accesses;
+    for (BasicBlock *BB : Body) {
+      // Only accesses executed in every iteration.
+      if (!DT.dominates(BB, Latch->getParent()))
+        continue;
+      for (auto &Inst : *BB) {
+        Value *Ptr;
+        ChunkAccess A;
+        if (LoadInst *LI = dyn_cast<LoadInst>(&Inst)) {
+          if (LI->isVolatile())
+            continue;
+          Ptr = LI->getPointerOperand();
+          A.IsWrite = false;
+        } else if (StoreInst *SI = dyn_cast<StoreInst>(&Inst)) {
+          if (SI->isVolatile())
+            continue;
+          Ptr = SI->getPointerOperand();
+          A.IsWrite = true;
+        } else {
+          continue;
+        }
+        GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(Ptr);
+        if (!GEP)
+          continue;
+        Value *Index;
+        if (GEP->getNumIndices() == 1) {
+          A.ArrayBase = false;
+          Index = GEP->getOperand(1);
+        } else if (GEP->getNumIndices() == 2 && isa<ConstantInt>(GEP->getOperand(1)) &&
+                   cast<ConstantInt>(GEP->getOperand(1))->isZero()) {
+          A.ArrayBase = true;
+          Index = GEP->getOperand(2);
+        } else {
+          continue;
+        }
+        A.IndexTy = nullptr;
+        A.IndexSigned = false;
+        if (isa<SExtInst>(Index) || isa<ZExtInst>(Index)) {
+          A.IndexTy = cast<CastInst>(Index)->getSrcTy();
+          A.IndexSigned = isa<SExtInst>(Index);
+        }
+        A.Base = getInvariantBase(GEP->getPointerOperand(), A.BaseLoads);
+        if (!A.Base || !matchAffine(Index, IV, A.Index, 0) ||
+            (A.Index.Scale != 1 && A.Index.Scale != -1))
+          continue;
+        A.Inst = &Inst;
+        A.ElemTy = cast<PointerType>(Ptr->getType())->getElementType();
+        Accesses.push_back(A);
+      }
+    }
+    if (Accesses.empty())
+      continue;
+
+    // A base pointer loaded from a shared variable must not be assigned in
+    // the loop.
+    SmallVector<ChunkAccess, 16> Valid;
+    for (ChunkAccess &A : Accesses) {
+      bool Stored = false;
+      if (A.BaseLoads == 2) {
+        Type *PtrTy = A.Base->getType();
+        for (unsigned i = 0; i < 2; i++)
+          PtrTy = cast<PointerType>(PtrTy)->getElementType();
+        for (BasicBlock *BB : Body)
+          for (auto &Inst : *BB)
+            if (StoreInst *SI = dyn_cast<StoreInst>(&Inst))
+              Stored |= SI->getValueOperand()->getType() == PtrTy;
+      }
+      if (!Stored)
+        Valid.push_back(A);
+    }
+
+    IRBuilder<> Builder(IVInit);
+    Type *Int64Ty = Builder.getInt64Ty();
+    // The _4u and _8u variants schedule unsigned iteration counters.
+    bool Unsigned = Init->getCalledFunction()->getName().endswith("u");
+    auto Extend = [&](Value *V) {
+      return Unsigned ? Builder.CreateZExtOrTrunc(V, Int64Ty)
+                      : Builder.CreateSExtOrTrunc(V, Int64Ty);
+    };
+    Value *Lower = Extend(Builder.CreateLoad(LB));
+    Value *Upper = Extend(Builder.CreateLoad(UB));
+    Value *Count = Builder.CreateAdd(Builder.CreateSub(Upper, Lower),
+                                     ConstantInt::get(Int64Ty, 1));
+    Count = Builder.CreateSelect(Builder.CreateICmpSGT(Count, ConstantInt::get(Int64Ty, 0)),
+                                 Count, ConstantInt::get(Int64Ty, 0));
+    std::set<std::tuple<Value*, bool, int64_t, int64_t, int64_t, AllocaInst*, Type*, bool, Type*, bool>> Done;
+    for (ChunkAccess &A : Valid) {
+      auto Key = std::make_tuple(A.Base, A.ArrayBase, A.Index.Scale,
+                                 A.Index.ConstOffset, A.Index.VarScale,
+                                 A.Index.VarOffset, A.ElemTy, A.IsWrite,
+                                 A.IndexTy, A.IndexSigned);
+      setMetadata(A.Inst, "nosanitize", "Archer static loop chunk");
+      if (!Done.insert(Key).second)
+        continue;
+      Value *Base = A.Base;
+      for (unsigned i = 0; i < A.BaseLoads; i++)
+        Base = Builder.CreateLoad(Base);
+      // The lowest index of the chunk.
+      Value *First = A.Index.Scale > 0 ? Lower : Builder.CreateNeg(Upper);
+      First = Builder.CreateAdd(First, ConstantInt::get(Int64Ty, A.Index.ConstOffset));
+      if (A.Index.VarOffset) {
+        Value *Off = Extend(Builder.CreateLoad(A.Index.VarOffset));
+        First = Builder.CreateAdd(First, Builder.CreateMul(Off, ConstantInt::get(Int64Ty, A.Index.VarScale)));
+      }
+      // Wrap around like the index computation of the loop body does.
+      if (A.IndexTy) {
+        First = Builder.CreateTrunc(First, A.IndexTy);
+        First = A.IndexSigned ? Builder.CreateSExt(First, Int64Ty)
+                              : Builder.CreateZExt(First, Int64Ty);
+      }
+      Value *Addr;
+      if (A.ArrayBase)
+        Addr = Builder.CreateGEP(Base, {ConstantInt::get(Int64Ty, 0), First});
+      else
+        Addr = Builder.CreateGEP(Base, First);
+      Value *Size = Builder.CreateMul(Count, ConstantInt::get(Int64Ty, DL.getTypeAllocSize(A.ElemTy)));
+      Builder.CreateCall(A.IsWrite ? WriteRange : ReadRange,
+                         {Builder.CreatePointerCast(Addr, Builder.getInt8PtrTy()),
+                          Builder.CreateZExtOrTrunc(Size, IntptrTy)});
+    }
+  }
+}
+
 bool InstrumentParallel::runOnFunction(Function &F) {
   llvm::GlobalVariable *ompStatusGlobal = NULL;
   Module *M = F.getParent();
@@ -149,6 +720,9 @@ bool InstrumentParallel::runOnFunction(Function &F) {
   ConstantInt *Zero = ConstantInt::get(Type::getInt32Ty(M->getContext()), 0);
   ConstantInt *One = ConstantInt::get(Type::getInt32Ty(M->getContext()), 1);
 
+  if (ClOffline)
+    rejectUntiedTasks(F);
+
   ompStatusGlobal = M->getNamedGlobal("__swordomp_status__");
   if(functionName.compare("main") == 0) {
     if(!ompStatusGlobal) {
@@ -206,8 +780,33 @@ bool InstrumentParallel::runOnFunction(Function &F) {
     IRBuilder<> builder2(block2);
     LoadInst *loadOmpStatus = builder2.CreateLoad(IRB2.getInt32Ty(), ompStatusGlobal);
     builder2.CreateRet(loadOmpStatus);
+
+    // Lets the runtime disable the instrumented clones while a region
+    // without races runs:
+    // void __swordomp__add_omp_status(int delta) {
+    //   __swordomp_status__ += delta;
+    // }
+    constant = M->getOrInsertFunction("__swordomp__add_omp_status",
+                                      IRB2.getVoidTy(),
+                                      IRB2.getInt32Ty(),
+                                      NULL);
+    Function* __swordomp_add_omp_status = cast<Function>(constant);
+    __swordomp_add_omp_status->setCallingConv(CallingConv::C);
+    BasicBlock* block3 = BasicBlock::Create(M->getContext(), "entry", __swordomp_add_omp_status);
+    IRBuilder<> builder3(block3);
+    LoadInst *loadStatus = builder3.CreateLoad(IRB2.getInt32Ty(), ompStatusGlobal);
+    Value *addStatus = builder3.CreateAdd(loadStatus, &*__swordomp_add_omp_status->arg_begin());
+    builder3.CreateStore(addStatus, ompStatusGlobal);
+    builder3.CreateRetVoid();
 #endif
 
+    if (ClOffline && !M->getNamedGlobal("__archer_offline_build")) {
+      // Tells the runtime to log accesses instead of relying on TSan.
+      new llvm::GlobalVariable(*M, Type::getInt32Ty(M->getContext()), true,
+                               llvm::GlobalValue::ExternalLinkage,
+                               One, "__archer_offline_build");
+    }
+
     F.removeFnAttr(llvm::Attribute::SanitizeThread);
     return true;
   }
@@ -217,6 +816,7 @@ bool InstrumentParallel::runOnFunction(Function &F) {
      functionName.endswith("__clang_call_terminate") ||
      functionName.endswith("__tsan_default_suppressions") ||
 	 functionName.endswith("__swordomp__get_omp_status") ||
+	 functionName.endswith("__swordomp__add_omp_status") ||
      (F.getLinkage() == llvm::GlobalValue::AvailableExternallyLinkage)) {
     return true;
   }
@@ -231,6 +831,9 @@ bool InstrumentParallel::runOnFunction(Function &F) {
                                0, true);
   }
 
+  // Outside the change set only the uninstrumented code is generated.
+  bool Instrument = !Incremental || Selected.count(functionName);
+
   if(functionName.startswith(".omp")) {
     // Increment of __swordomp_status__
     Instruction *entryBBI = &F.getEntryBlock().front();
@@ -262,6 +865,15 @@ bool InstrumentParallel::runOnFunction(Function &F) {
     } else {
       report_fatal_error("Broken function found, compilation aborted!");
     }
+
+    if (!Instrument)
+      F.removeFnAttr(llvm::Attribute::SanitizeThread);
+    else if (ClOffline)
+      instrumentMemoryAccesses(F, ompStatusGlobal);
+    else if (ClStaticLoops)
+      instrumentStaticLoops(F);
+  } else if (!Instrument) {
+    F.removeFnAttr(llvm::Attribute::SanitizeThread);
   } else {
     ValueToValueMapTy VMap;
     Function *new_function = CloneFunction(&F, VMap);
@@ -313,6 +925,9 @@ bool InstrumentParallel::runOnFunction(Function &F) {
       parallelCall->setDebugLoc(firstEntryBBDI->getDebugLoc());
       ReturnInst::Create(M->getContext(), parallelCall, swordThenBB);
     }
+
+    if (ClOffline)
+      instrumentMemoryAccesses(*new_function, ompStatusGlobal);
  }
 
   return true;
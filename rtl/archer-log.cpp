@@ -0,0 +1,177 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "archer-log.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+__thread ArcherLogWriter *archer_thread_log;
+
+static std::string log_dir;
+static size_t log_buffer_size;
+static std::mutex writers_mutex;
+static std::vector<ArcherLogWriter *> writers;
+
+static void write_all(int fd, const void *buf, size_t size) {
+  const char *p = (const char *)buf;
+  while (size > 0) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("Archer: could not write log");
+      return;
+    }
+    p += n;
+    size -= n;
+  }
+}
+
+ArcherLogWriter::ArcherLogWriter(int fd, uint32_t thread, size_t buffer_size)
+    : Fd(fd), BufferSize(buffer_size), Pos(0), LastAddr(nullptr), LastPc(nullptr),
+      Buffer(new uint8_t[BufferSize]) {
+  memset(Runs, 0, sizeof(Runs));
+  ArcherLogHeader header;
+  memcpy(header.magic, ARCHER_LOG_MAGIC, sizeof(header.magic));
+  header.version = ARCHER_LOG_VERSION;
+  header.thread = thread;
+  memcpy(Buffer, &header, sizeof(header));
+  Pos = sizeof(header);
+}
+
+ArcherLogWriter::~ArcherLogWriter() {
+  flush();
+  close(Fd);
+  delete[] Buffer;
+}
+
+void ArcherLogWriter::flush() {
+  flushRuns();
+  writeBuffer();
+}
+
+void ArcherLogWriter::writeBuffer() {
+  write_all(Fd, Buffer, Pos);
+  Pos = 0;
+}
+
+bool archer_log_init(const char *dir, size_t buffer_size) {
+  if (mkdir(dir, 0755) && errno != EEXIST)
+    return false;
+  log_dir = dir;
+  // The buffer has to hold the file header and the largest record.
+  log_buffer_size = buffer_size < 4096 ? 4096 : buffer_size;
+  return true;
+}
+
+ArcherLogWriter *archer_log_thread_begin(uint32_t thread) {
+  std::string name = log_dir + "/thread_" + std::to_string(thread) + ".log";
+  int fd = open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "Archer: could not create %s: %s\n", name.c_str(),
+            strerror(errno));
+    return nullptr;
+  }
+  ArcherLogWriter *writer = new ArcherLogWriter(fd, thread, log_buffer_size);
+  {
+    std::lock_guard<std::mutex> lock(writers_mutex);
+    writers.push_back(writer);
+  }
+  archer_thread_log = writer;
+  return writer;
+}
+
+void archer_log_finalize() {
+  // The other threads are idle by now. Keep the writers alive in case some
+  // instrumented code still runs during process shutdown.
+  {
+    std::lock_guard<std::mutex> lock(writers_mutex);
+    for (size_t i = 0; i < writers.size(); i++)
+      writers[i]->flush();
+  }
+
+  // The analyzer needs the module map to report program counters relative to
+  // their module.
+  int in = open("/proc/self/maps", O_RDONLY);
+  if (in < 0)
+    return;
+  std::string name = log_dir + "/maps";
+  int out = open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (out >= 0) {
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(in, buf, sizeof(buf))) > 0)
+      write_all(out, buf, n);
+    close(out);
+  }
+  close(in);
+}
+
+// Entry points for the accesses instrumented by the Archer pass in offline
+// mode.
+extern "C" {
+void __archer_log_read(void *addr, uint32_t size) {
+  if (ArcherLogWriter *log = archer_thread_log)
+    log->access(addr, size, false, __builtin_return_address(0));
+}
+
+void __archer_log_write(void *addr, uint32_t size) {
+  if (ArcherLogWriter *log = archer_thread_log)
+    log->access(addr, size, true, __builtin_return_address(0));
+}
+}
@@ -0,0 +1,301 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Log format of Archer's offline mode.
+//
+// In offline mode the instrumented application does not check accesses with
+// TSan. Instead, every OpenMP thread streams its memory accesses and the
+// synchronization structure reported by the OMPT callbacks into its own log
+// file. The archer-analyze tool reads the logs of all threads after the run
+// and checks accesses of concurrent intervals for races.
+//
+// A log starts with an ArcherLogHeader, followed by records. Every record
+// starts with one type byte. Integers are stored as LEB128 varints, addresses
+// and program counters of accesses as zigzag encoded deltas to the previous
+// access of the same thread.
+//
+// Accesses of the same program counter to contiguous or strided addresses
+// are combined into a single run record (base, stride, count) before they are
+// written. Open runs are written before the next synchronization event, so
+// all accesses of a run belong to the same interval.
+
+#ifndef ARCHER_LOG_H
+#define ARCHER_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ARCHER_LOG_MAGIC "ARCHLOG1"
+#define ARCHER_LOG_VERSION 2
+
+struct ArcherLogHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t thread;
+};
+
+enum ArcherLogRecord {
+  // Accesses: the low bits encode the size, sizes that are no power of two
+  // (or larger than 16 bytes) use LOG_SIZE_OTHER and store it as a varint.
+  // addr delta, pc delta [, size]
+  LOG_ACCESS_READ = 0x00,
+  LOG_ACCESS_WRITE = 0x08,
+  LOG_ACCESS_MASK = 0x0f,
+  LOG_SIZE_OTHER = 0x07,
+
+  // Runs of accesses, the low bits are encoded like for single accesses.
+  // addr delta, pc delta [, size], zigzag stride, count
+  LOG_RUN_READ = 0x40,
+  LOG_RUN_WRITE = 0x48,
+  LOG_RUN_MASK = 0xf0,
+
+  // new task id, parent task id (0 for initial tasks), 1 if the task is
+  // included, i.e. completes before the parent continues
+  LOG_TASK_CREATE = 0x10,
+  // task id: this thread now executes the given task
+  LOG_TASK_SWITCH,
+  // implicit task id, region id, thread num, encountering task id,
+  // barrier epoch of the encountering task
+  LOG_IMPLICIT_BEGIN,
+  // implicit task id
+  LOG_IMPLICIT_END,
+  // implicit task id, new barrier epoch
+  LOG_BARRIER_END,
+  // task id
+  LOG_TASKWAIT_END,
+  // task id
+  LOG_TASKGROUP_BEGIN,
+  // task id
+  LOG_TASKGROUP_END,
+  // wait id
+  LOG_MUTEX_ACQUIRED,
+  // wait id
+  LOG_MUTEX_RELEASED,
+  // task id, dependence address, 1 for out and inout dependences
+  LOG_TASK_DEPENDENCE,
+};
+
+static inline size_t archer_log_size_code(uint32_t size) {
+  switch (size) {
+  case 1: return 0;
+  case 2: return 1;
+  case 4: return 2;
+  case 8: return 3;
+  case 16: return 4;
+  default: return LOG_SIZE_OTHER;
+  }
+}
+
+static inline uint32_t archer_log_code_size(size_t code) {
+  return 1u << code;
+}
+
+static inline uint64_t archer_log_zigzag(int64_t v) {
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t archer_log_unzigzag(uint64_t v) {
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+#ifdef __cplusplus
+
+/// Per-thread writer for the offline log. Records are collected in a fixed
+/// size buffer which is written to the thread's log file when it is full.
+class ArcherLogWriter {
+public:
+  ArcherLogWriter(int fd, uint32_t thread, size_t buffer_size);
+  ~ArcherLogWriter();
+
+  void access(const void *addr, uint32_t size, bool write, const void *pc) {
+    Run &r = Runs[((uintptr_t)pc ^ ((uintptr_t)pc >> 7)) & (RunSlots - 1)];
+    uintptr_t a = (uintptr_t)addr;
+    if (r.Count && r.Pc == pc && r.Size == size && r.Write == write) {
+      if (r.Count == 1) {
+        r.Stride = a - r.Base;
+        r.Count = 2;
+        return;
+      }
+      if (a == r.Base + r.Stride * r.Count) {
+        r.Count++;
+        return;
+      }
+    }
+    if (r.Count)
+      putRun(r);
+    r.Pc = pc;
+    r.Base = a;
+    r.Stride = 0;
+    r.Count = 1;
+    r.Size = size;
+    r.Write = write;
+  }
+
+  void event(ArcherLogRecord type, uint64_t a) {
+    flushRuns();
+    reserve(1 + MaxVarint);
+    put(type);
+    putVarint(a);
+  }
+
+  void event(ArcherLogRecord type, uint64_t a, uint64_t b) {
+    flushRuns();
+    reserve(1 + 2 * MaxVarint);
+    put(type);
+    putVarint(a);
+    putVarint(b);
+  }
+
+  void event(ArcherLogRecord type, uint64_t a, uint64_t b, uint64_t c) {
+    flushRuns();
+    reserve(1 + 3 * MaxVarint);
+    put(type);
+    putVarint(a);
+    putVarint(b);
+    putVarint(c);
+  }
+
+  void event(ArcherLogRecord type, uint64_t a, uint64_t b, uint64_t c,
+             uint64_t d, uint64_t e) {
+    flushRuns();
+    reserve(1 + 5 * MaxVarint);
+    put(type);
+    putVarint(a);
+    putVarint(b);
+    putVarint(c);
+    putVarint(d);
+    putVarint(e);
+  }
+
+  /// Write the open runs and the buffered records to the log file.
+  void flush();
+
+private:
+  static const size_t MaxVarint = 10;
+  static const size_t RunSlots = 64;
+
+  /// Accesses of one program counter that are not written yet.
+  struct Run {
+    const void *Pc;
+    uintptr_t Base;
+    uintptr_t Stride;
+    uint64_t Count;
+    uint32_t Size;
+    bool Write;
+  };
+
+  void reserve(size_t n) {
+    if (Pos + n > BufferSize)
+      writeBuffer();
+  }
+
+  void writeBuffer();
+
+  void putRun(const Run &r) {
+    reserve(1 + 5 * MaxVarint);
+    size_t code = archer_log_size_code(r.Size);
+    if (r.Count == 1)
+      put((r.Write ? LOG_ACCESS_WRITE : LOG_ACCESS_READ) | code);
+    else
+      put((r.Write ? LOG_RUN_WRITE : LOG_RUN_READ) | code);
+    putVarint(archer_log_zigzag((intptr_t)r.Base - (intptr_t)LastAddr));
+    putVarint(archer_log_zigzag((intptr_t)r.Pc - (intptr_t)LastPc));
+    if (code == LOG_SIZE_OTHER)
+      putVarint(r.Size);
+    if (r.Count > 1) {
+      putVarint(archer_log_zigzag((intptr_t)r.Stride));
+      putVarint(r.Count);
+    }
+    LastAddr = (const void *)r.Base;
+    LastPc = r.Pc;
+  }
+
+  void flushRuns() {
+    for (size_t i = 0; i < RunSlots; i++)
+      if (Runs[i].Count) {
+        putRun(Runs[i]);
+        Runs[i].Count = 0;
+      }
+  }
+
+  void put(uint8_t byte) { Buffer[Pos++] = byte; }
+
+  void putVarint(uint64_t v) {
+    while (v >= 0x80) {
+      Buffer[Pos++] = (uint8_t)(v | 0x80);
+      v >>= 7;
+    }
+    Buffer[Pos++] = (uint8_t)v;
+  }
+
+  int Fd;
+  size_t BufferSize;
+  size_t Pos;
+  const void *LastAddr;
+  const void *LastPc;
+  uint8_t *Buffer;
+  Run Runs[RunSlots];
+};
+
+/// Create the log directory for this process, returns false on failure.
+/// Every thread buffers buffer_size bytes of records before writing them.
+bool archer_log_init(const char *dir, size_t buffer_size);
+
+/// Create the writer for the calling thread.
+ArcherLogWriter *archer_log_thread_begin(uint32_t thread);
+
+/// Flush the logs of all threads and record the module map of the process.
+void archer_log_finalize();
+
+/// The writer of the calling thread, nullptr if this thread is not logging.
+extern __thread ArcherLogWriter *archer_thread_log;
+
+#endif // __cplusplus
+
+#endif // ARCHER_LOG_H
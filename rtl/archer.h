@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Interface of the Archer runtime for applications.
+ *
+ * The functions are declared weak, so an application can call them only
+ * if libarcher is loaded:
+ *
+ *   struct archer_stats stats;
+ *   if (archer_get_stats && archer_get_stats(&stats) == 0)
+ *     printf("%llu tasks\n", (unsigned long long)stats.task_data.count);
+ */
+
+#ifndef ARCHER_H
+#define ARCHER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Memory Archer uses for one kind of bookkeeping object. */
+struct archer_object_stats {
+  /* Objects in use and their size. */
+  uint64_t count;
+  uint64_t bytes;
+  /* Highest number of objects in use so far and their highest size. */
+  uint64_t peak_count;
+  uint64_t peak_bytes;
+  /* Objects allocated, in use or kept free in the pools, the memory
+   * Archer holds for the kind. Pools only shrink with pool_trim. */
+  uint64_t pooled_count;
+  uint64_t pooled_bytes;
+};
+
+/* Sums over all threads. Objects are counted in batches per thread, so
+ * count and peak_count may be off by 64 objects per thread. */
+struct archer_stats {
+  /* One per parallel region. */
+  struct archer_object_stats parallel_data;
+  /* One per implicit and explicit task, kept until all its children
+   * completed. */
+  struct archer_object_stats task_data;
+  /* One per taskgroup. */
+  struct archer_object_stats taskgroup;
+  /* One array per task with dependences. */
+  struct archer_object_stats dependences;
+  /* One mutex per lock, critical section, atomic and ordered construct
+   * that was used, never freed. */
+  struct archer_object_stats locks;
+};
+
+/* Fill stats, returns 0 on success and -1 if the runtime is not active. */
+int archer_get_stats(struct archer_stats *stats) __attribute__((weak));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARCHER_H */
@@ -0,0 +1,141 @@
+! Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+!
+! Produced at the Lawrence Livermore National Laboratory
+!
+! Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+! (joachim.protze@tu-dresden.de), Jonas Hahnfeld
+! (hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+! Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+! Schulz.
+!
+! LLNL-CODE-727057
+!
+! All rights reserved.
+!
+! This file is part of Archer. For details, see
+! https://pruners.github.io/archer. Please also read
+! https://github.com/PRUNERS/archer/blob/master/LICENSE.
+!
+! Redistribution and use in source and binary forms, with or without
+! modification, are permitted provided that the following conditions are
+! met:
+!
+!    Redistributions of source code must retain the above copyright
+!    notice, this list of conditions and the disclaimer below.
+!
+!    Redistributions in binary form must reproduce the above copyright
+!    notice, this list of conditions and the disclaimer (as noted below)
+!    in the documentation and/or other materials provided with the
+!    distribution.
+!
+!    Neither the name of the LLNS/LLNL nor the names of its contributors
+!    may be used to endorse or promote products derived from this
+!    software without specific prior written permission.
+!
+! THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+! "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+! LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+! A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+! LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+! CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+! EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+! PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+! PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+! LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+! NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+! SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+! Fortran interfaces to the TSan annotations used with Archer.
+!
+! The Annotate* interfaces bind directly to the entry points of the TSan
+! runtime, so a call costs no more than from C. Fortran strings are not
+! terminated, pass c_char_"" or a file name with c_null_char appended, and
+! pass the synchronization variable itself:
+!
+!   use archer_annotations
+!   call AnnotateHappensBefore(c_char_""//c_null_char, __LINE__, flag)
+!
+! The archer_*_range and archer_*_strided helpers annotate a whole array or
+! array section with a single call into libfarcher. Pass the first element
+! of the section, never the section itself, which may be copied. E.g. for
+! the row a(i, :) of a two-dimensional array:
+!
+!   call archer_benign_race_strided(a(i, 1), size(a, 2, c_size_t), &
+!        size(a, 1, c_ptrdiff_t) * c_sizeof(a(1, 1)), c_sizeof(a(1, 1)))
+!
+! Link with -lfarcher, which also provides no-op fallbacks of the Annotate*
+! functions for builds without TSan.
+
+module archer_annotations
+  use, intrinsic :: iso_c_binding
+  implicit none
+
+  interface
+    subroutine AnnotateHappensBefore(file, line, addr) &
+        bind(C, name="AnnotateHappensBefore")
+      import :: c_char, c_int
+      character(kind=c_char), dimension(*), intent(in) :: file
+      integer(c_int), value :: line
+      type(*), intent(in) :: addr
+    end subroutine
+
+    subroutine AnnotateHappensAfter(file, line, addr) &
+        bind(C, name="AnnotateHappensAfter")
+      import :: c_char, c_int
+      character(kind=c_char), dimension(*), intent(in) :: file
+      integer(c_int), value :: line
+      type(*), intent(in) :: addr
+    end subroutine
+
+    subroutine AnnotateIgnoreWritesBegin(file, line) &
+        bind(C, name="AnnotateIgnoreWritesBegin")
+      import :: c_char, c_int
+      character(kind=c_char), dimension(*), intent(in) :: file
+      integer(c_int), value :: line
+    end subroutine
+
+    subroutine AnnotateIgnoreWritesEnd(file, line) &
+        bind(C, name="AnnotateIgnoreWritesEnd")
+      import :: c_char, c_int
+      character(kind=c_char), dimension(*), intent(in) :: file
+      integer(c_int), value :: line
+    end subroutine
+
+    ! Accesses to the bytes starting at addr are not reported as races.
+    subroutine archer_benign_race_range(addr, bytes) &
+        bind(C, name="archer_benign_race_range")
+      import :: c_size_t
+      type(*), intent(in) :: addr
+      integer(c_size_t), value :: bytes
+    end subroutine
+
+    ! Like archer_benign_race_range for count elements of the given size,
+    ! stride bytes apart.
+    subroutine archer_benign_race_strided(addr, count, stride, bytes) &
+        bind(C, name="archer_benign_race_strided")
+      import :: c_size_t, c_ptrdiff_t
+      type(*), intent(in) :: addr
+      integer(c_size_t), value :: count
+      integer(c_ptrdiff_t), value :: stride
+      integer(c_size_t), value :: bytes
+    end subroutine
+
+    ! Forget the earlier accesses to the bytes starting at addr, e.g. when a
+    ! buffer is reused for unrelated data.
+    subroutine archer_new_memory_range(addr, bytes) &
+        bind(C, name="archer_new_memory_range")
+      import :: c_size_t
+      type(*), intent(in) :: addr
+      integer(c_size_t), value :: bytes
+    end subroutine
+
+    subroutine archer_new_memory_strided(addr, count, stride, bytes) &
+        bind(C, name="archer_new_memory_strided")
+      import :: c_size_t, c_ptrdiff_t
+      type(*), intent(in) :: addr
+      integer(c_size_t), value :: count
+      integer(c_ptrdiff_t), value :: stride
+      integer(c_size_t), value :: bytes
+    end subroutine
+  end interface
+end module archer_annotations
@@ -0,0 +1,157 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "clean-regions.h"
+#include "modules.h"
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+CleanRegionDB::CleanRegionDB(const char *filename)
+    : Filename(filename), Reports(false) {}
+
+CleanRegionDB::~CleanRegionDB() {
+  for (auto &Region : Regions)
+    delete Region.second;
+}
+
+std::set<std::string> CleanRegionDB::readFile(const std::string &filename) {
+  std::set<std::string> Result;
+  FILE *File = fopen(filename.c_str(), "r");
+  if (!File)
+    return Result;
+  char Line[256];
+  while (fgets(Line, sizeof(Line), File)) {
+    Line[strcspn(Line, "\n")] = '\0';
+    if (Line[0] != '\0' && Line[0] != '#')
+      Result.insert(Line);
+  }
+  fclose(File);
+  return Result;
+}
+
+void CleanRegionDB::load() {
+  Entries = readFile(Filename);
+}
+
+CleanRegion *CleanRegionDB::lookup(const void *codeptr) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto It = Regions.find(codeptr);
+  if (It != Regions.end())
+    return It->second;
+
+  CleanRegion *Region = nullptr;
+  LoadedModule Module;
+  uintptr_t Addr = reinterpret_cast<uintptr_t>(codeptr);
+  if (findModule(Addr, Module)) {
+    auto Id = BuildIds.find(Module.Base);
+    if (Id == BuildIds.end())
+      Id = BuildIds.emplace(Module.Base, readBuildId(Module)).first;
+    if (!Id->second.empty()) {
+      char Offset[32];
+      snprintf(Offset, sizeof(Offset), " %" PRIxPTR, Addr - Module.Base);
+      std::string Key = Id->second + Offset;
+      Region = new CleanRegion(Key, Entries.count(Key) != 0);
+    }
+  }
+  // Also remember code pointers that cannot be identified.
+  Regions.emplace(codeptr, Region);
+  return Region;
+}
+
+bool CleanRegionDB::save() {
+  std::string Lockname = Filename + ".lock";
+  int Lock = open(Lockname.c_str(), O_RDWR | O_CREAT, 0644);
+  if (Lock < 0)
+    return false;
+  flock(Lock, LOCK_EX);
+
+  // Start from the current file, other runs may have updated it since load.
+  std::set<std::string> Merged = readFile(Filename);
+  bool AnyReport = Reports.load(std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> Guard(Mutex);
+    for (auto &It : Regions) {
+      CleanRegion *Region = It.second;
+      if (!Region)
+        continue;
+      if (Region->Reported || (AnyReport && Region->Checked))
+        Merged.erase(Region->Key);
+      else if (!AnyReport && Region->Checked && !Region->Partial)
+        Merged.insert(Region->Key);
+    }
+  }
+
+  // Replace the file atomically so that readers never see a partial database.
+  char Suffix[32];
+  snprintf(Suffix, sizeof(Suffix), ".%d", getpid());
+  std::string Tmpname = Filename + Suffix;
+  bool Success = false;
+  FILE *File = fopen(Tmpname.c_str(), "w");
+  if (File) {
+    fprintf(File, "# Archer clean regions: <build-id> <offset>\n");
+    for (auto &Entry : Merged)
+      fprintf(File, "%s\n", Entry.c_str());
+    Success = fclose(File) == 0 && rename(Tmpname.c_str(), Filename.c_str()) == 0;
+    if (!Success)
+      unlink(Tmpname.c_str());
+  }
+
+  flock(Lock, LOCK_UN);
+  close(Lock);
+  return Success;
+}
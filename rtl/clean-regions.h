@@ -0,0 +1,124 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef ARCHER_CLEAN_REGIONS_H
+#define ARCHER_CLEAN_REGIONS_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+/// What is known about one parallel region (identified by its codeptr_ra)
+/// during this run.
+struct CleanRegion {
+  /// Identifies the region across runs: build-id of the module containing
+  /// the code pointer and the offset of the code pointer in that module.
+  std::string Key;
+
+  /// The database listed the region as clean when the run started.
+  bool Clean;
+
+  /// At least one implicit task of the region ran with checks enabled.
+  std::atomic<bool> Checked;
+
+  /// Some implicit task of the region ran with checks disabled.
+  std::atomic<bool> Partial;
+
+  /// TSan reported a race while the region was active on the reporting
+  /// thread. The region of the other access is not known.
+  std::atomic<bool> Reported;
+
+  CleanRegion(const std::string &Key, bool Clean)
+    : Key(Key), Clean(Clean), Checked(false), Partial(false), Reported(false)
+  {}
+};
+
+/// Database of parallel regions that were fully checked in earlier runs of
+/// the same binary that produced no report at all. Every line of the file holds the
+/// build-id of a module and the offset of a region's code pointer in it, so
+/// entries become stale automatically when the module is rebuilt.
+class CleanRegionDB {
+public:
+  CleanRegionDB(const char *filename);
+  ~CleanRegionDB();
+
+  /// Read the database, a missing file is an empty database.
+  void load();
+
+  /// Region for the given code pointer, nullptr if the module containing it
+  /// has no build-id.
+  CleanRegion *lookup(const void *codeptr);
+
+  /// Note that TSan reported a race in this run.
+  void reported() { Reports.store(true, std::memory_order_relaxed); }
+
+  /// Merge the results of this run into the database. The file is re-read
+  /// under a lock so that concurrent runs do not lose each other's updates.
+  bool save();
+
+private:
+  static std::set<std::string> readFile(const std::string &filename);
+
+  std::string Filename;
+  std::set<std::string> Entries;
+
+  /// A report only names the regions of the reporting thread, the other
+  /// access may belong to any checked region. Runs with reports therefore
+  /// record no region as clean.
+  std::atomic<bool> Reports;
+
+  std::mutex Mutex;
+  std::unordered_map<const void *, CleanRegion *> Regions;
+  std::unordered_map<uintptr_t, std::string> BuildIds;
+};
+
+#endif // ARCHER_CLEAN_REGIONS_H
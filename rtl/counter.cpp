@@ -51,13 +51,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define OUTPUT_IF_NOT_NULL(format,value) if (value) printf(format, value)
 
-void print_callbacks(callback_counter_t *counter){
+void print_callbacks(callback_counter_t **counters){
+    callback_counter_t *counter = counters[0];
     int* basecounter = (int*)counter;
-    int total_callbacks;
+    int total_callbacks = 0;
     for(int i = 1; i<MAX_THREADS; i++){
-        // if we have at least i threads, this thread should have a thread_begin event:
-        if (counter[i].thread_begin==0) break;
-        int* threadcounter = (int*)(counter+i);
+        // if we have at least i threads, this thread has allocated its counters:
+        if (counters[i]==NULL) break;
+        int* threadcounter = (int*)(counters[i]);
         for(int j=0; j<sizeof(callback_counter_t)/sizeof(int); j++)
             basecounter[j] += threadcounter[j];
     }
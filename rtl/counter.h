@@ -47,6 +47,9 @@ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#ifndef ARCHER_COUNTER_H
+#define ARCHER_COUNTER_H
+
 #include <stdio.h>
 #include <inttypes.h>
 #include <omp.h>
@@ -117,8 +120,11 @@ typedef struct alignas(128) {
 extern "C" {
 #endif
 
-void print_callbacks(callback_counter_t *counter);
+// counter[i] points to the counters of thread i, the list ends with NULL.
+void print_callbacks(callback_counter_t **counter);
 
 #ifdef  __cplusplus
 }
 #endif
+
+#endif // ARCHER_COUNTER_H
@@ -0,0 +1,301 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "flags.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <unistd.h>
+
+static const char *const mode_names[] = {"full", "counting", "profiling", nullptr};
+
+ArcherFlags::ArcherFlags(const char *env) :
+  mode(ARCHER_MODE_FULL),
+  ignore_mutexes(0),
+#if (LLVM_VERSION) >= 40
+  flush_shadow(0),
+  flush_every(1),
+  flush_interval(0),
+  flush_max_rss(0),
+#endif
+  pool_trim(0),
+  print_ompt_counters(0),
+  print_max_rss(0),
+  rss_sampling(0),
+  rss_file("archer_rss_%p.csv"),
+  live_stats(0),
+  report_dir(""),
+  report_symbolize(1),
+  clean_regions(0),
+  clean_regions_file("archer_clean_regions.db"),
+  log_dir("archer_log_%p"),
+  log_buffer_size(64 * 1024),
+  verbose(0),
+  help(0) {
+  addFlag("mode", &mode, mode_names,
+          "Detect races (full), only count the OMPT events (counting) or "
+          "only track parallel regions (profiling).");
+  addFlag("ignore_mutexes", &ignore_mutexes,
+          "Do not register the mutex callbacks, for programs without locks.");
+#if (LLVM_VERSION) >= 40
+  addFlag("flush_shadow", &flush_shadow,
+          "Flush the shadow memory at the end of an outer parallel region.");
+  addFlag("flush_every", &flush_every,
+          "Only flush at the end of every N-th outer parallel region.");
+  addFlag("flush_interval", &flush_interval,
+          "Minimum time in milliseconds between two flushes.");
+  addFlag("flush_max_rss", &flush_max_rss,
+          "Only flush when the RSS exceeds the given number of MBytes.");
+#endif
+  addFlag("pool_trim", &pool_trim,
+          "Release free pool memory at the end of outermost parallel regions "
+          "if more than this fraction of a pool is free, 0 never releases.");
+  addFlag("print_ompt_counters", &print_ompt_counters,
+          "Print the number of triggered OMPT events at exit.");
+  addFlag("print_max_rss", &print_max_rss,
+          "Print the RSS peak at exit.");
+  addFlag("rss_sampling", &rss_sampling,
+          "Sample the RSS every N milliseconds into rss_file.");
+  addFlag("rss_file", &rss_file,
+          "File for the RSS samples, %p is replaced by the process id.");
+  addFlag("live_stats", &live_stats,
+          "Publish statistics every N milliseconds in the shared memory "
+          "segment /archer.<pid> for archer-top.");
+  addFlag("report_dir", &report_dir,
+          "Directory for the race reports of every process as JSON lines "
+          "for archer-merge.");
+  addFlag("report_symbolize", &report_symbolize,
+          "Symbolize the reports in report_dir in the process, 0 leaves it "
+          "to archer-merge.");
+  addFlag("clean_regions", &clean_regions,
+          "Skip (1) or recheck (2) regions that earlier runs found clean.");
+  addFlag("clean_regions_file", &clean_regions_file,
+          "Database of the regions found clean.");
+  addFlag("log_dir", &log_dir,
+          "Directory of the offline logs, %p is replaced by the process id.");
+  addFlag("log_buffer_size", &log_buffer_size,
+          "Size of the offline log buffer of every thread.");
+  addFlag("verbose", &verbose,
+          "Print the value of every option at startup and every shadow "
+          "memory flush.");
+  addFlag("help", &help,
+          "Print the available options at startup.");
+
+  if (!env)
+    return;
+  std::istringstream iss(env);
+  std::string token;
+  while (iss >> token) {
+    size_t eq = token.find('=');
+    std::string name = token.substr(0, eq);
+    const Flag *flag = nullptr;
+    for (const Flag &f : Flags)
+      if (name == f.Name)
+        flag = &f;
+    if (!flag) {
+      std::cerr << "Archer: unknown option in ARCHER_OPTIONS: " << name << std::endl;
+    } else if (eq == std::string::npos || !parse(*flag, token.substr(eq + 1))) {
+      std::cerr << "Illegal values for ARCHER_OPTIONS variable: " << token << std::endl;
+    }
+  }
+}
+
+void ArcherFlags::add(const char *name, FlagType type, void *value,
+                      const char *help, const char *const *choices) {
+  Flag flag = {name, type, value, help, choices, std::string()};
+  flag.Default = format(flag);
+  Flags.push_back(flag);
+}
+
+void ArcherFlags::addFlag(const char *name, int *value, const char *help) {
+  add(name, FLAG_INT, value, help, nullptr);
+}
+
+void ArcherFlags::addFlag(const char *name, size_t *value, const char *help) {
+  add(name, FLAG_SIZE, value, help, nullptr);
+}
+
+void ArcherFlags::addFlag(const char *name, double *value, const char *help) {
+  add(name, FLAG_DOUBLE, value, help, nullptr);
+}
+
+void ArcherFlags::addFlag(const char *name, std::string *value, const char *help) {
+  add(name, FLAG_STRING, value, help, nullptr);
+}
+
+void ArcherFlags::addFlag(const char *name, int *value,
+                          const char *const *choices, const char *help) {
+  add(name, FLAG_ENUM, value, help, choices);
+}
+
+bool ArcherFlags::parse(const Flag &flag, const std::string &value) {
+  const char *str = value.c_str();
+  char *end;
+  errno = 0;
+  switch (flag.Type) {
+  case FLAG_INT: {
+    long v = strtol(str, &end, 0);
+    if (end == str || *end || errno || v != (int)v)
+      return false;
+    *static_cast<int *>(flag.Value) = (int)v;
+    return true;
+  }
+  case FLAG_SIZE: {
+    // Sizes take an optional K, M or G suffix.
+    unsigned long long v = strtoull(str, &end, 0);
+    if (end == str || errno || value[0] == '-')
+      return false;
+    int shift = 0;
+    switch (*end) {
+    case 'g': case 'G': shift += 10; // fall through
+    case 'm': case 'M': shift += 10; // fall through
+    case 'k': case 'K': shift += 10; end++; break;
+    }
+    // Reject values that do not fit a size_t once scaled.
+    if (*end || v > (std::numeric_limits<size_t>::max() >> shift))
+      return false;
+    v <<= shift;
+    *static_cast<size_t *>(flag.Value) = (size_t)v;
+    return true;
+  }
+  case FLAG_DOUBLE: {
+    double v = strtod(str, &end);
+    if (end == str || *end || errno)
+      return false;
+    *static_cast<double *>(flag.Value) = v;
+    return true;
+  }
+  case FLAG_STRING:
+    *static_cast<std::string *>(flag.Value) = value;
+    return true;
+  case FLAG_ENUM:
+    for (int i = 0; flag.Choices[i]; i++)
+      if (value == flag.Choices[i]) {
+        *static_cast<int *>(flag.Value) = i;
+        return true;
+      }
+    return false;
+  }
+  return false;
+}
+
+std::string ArcherFlags::format(const Flag &flag) const {
+  std::ostringstream os;
+  switch (flag.Type) {
+  case FLAG_INT:
+    os << *static_cast<int *>(flag.Value);
+    break;
+  case FLAG_SIZE:
+    os << *static_cast<size_t *>(flag.Value);
+    break;
+  case FLAG_DOUBLE:
+    os << *static_cast<double *>(flag.Value);
+    break;
+  case FLAG_STRING:
+    os << *static_cast<std::string *>(flag.Value);
+    break;
+  case FLAG_ENUM:
+    os << flag.Choices[*static_cast<int *>(flag.Value)];
+    break;
+  }
+  return os.str();
+}
+
+const char *ArcherFlags::typeName(const Flag &flag) {
+  switch (flag.Type) {
+  case FLAG_INT:
+    return "int";
+  case FLAG_SIZE:
+    return "size";
+  case FLAG_DOUBLE:
+    return "double";
+  case FLAG_STRING:
+    return "string";
+  case FLAG_ENUM:
+    return "enum";
+  }
+  return "";
+}
+
+void ArcherFlags::printHelp(std::ostream &os) const {
+  os << "Archer options (ARCHER_OPTIONS=\"name=value ...\"):" << std::endl;
+  for (const Flag &flag : Flags) {
+    os << "  " << flag.Name << " (" << typeName(flag);
+    if (flag.Type == FLAG_ENUM) {
+      os << ":";
+      for (int i = 0; flag.Choices[i]; i++)
+        os << (i ? "|" : " ") << flag.Choices[i];
+    }
+    os << ", default " << flag.Default << ")" << std::endl
+       << "      " << flag.Help << std::endl;
+  }
+}
+
+void ArcherFlags::printValues(std::ostream &os) const {
+  os << "Archer options:" << std::endl;
+  for (const Flag &flag : Flags)
+    os << "  " << flag.Name << "=" << format(flag) << std::endl;
+}
+
+std::string ArcherFlags::expandPid(const std::string &name) {
+  std::string result;
+  for (size_t i = 0; i < name.size(); i++) {
+    if (name[i] == '%' && i + 1 < name.size() && name[i + 1] == 'p') {
+      result += std::to_string(getpid());
+      i++;
+    } else {
+      result += name[i];
+    }
+  }
+  return result;
+}
@@ -0,0 +1,136 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef ARCHER_FLAGS_H
+#define ARCHER_FLAGS_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// What the runtime does with the OMPT events (the mode option).
+enum ArcherMode {
+  /// Race detection with TSan.
+  ARCHER_MODE_FULL,
+  /// Only count the events of all callbacks, see print_ompt_counters.
+  ARCHER_MODE_COUNTING,
+  /// Only track the parallel regions for the RSS sampler.
+  ARCHER_MODE_PROFILING
+};
+
+/// Runtime options, parsed from the ARCHER_OPTIONS environment variable.
+/// Every option is registered in a table together with its type and a
+/// description, which drives the parser, help=1 and verbose=1.
+class ArcherFlags {
+public:
+  int mode;
+  int ignore_mutexes;
+#if (LLVM_VERSION) >= 40
+  int flush_shadow;
+  int flush_every;
+  int flush_interval;
+  int flush_max_rss;
+#endif
+  double pool_trim;
+  int print_ompt_counters;
+  int print_max_rss;
+  int rss_sampling;
+  std::string rss_file;
+  int live_stats;
+  std::string report_dir;
+  int report_symbolize;
+  int clean_regions;
+  std::string clean_regions_file;
+  std::string log_dir;
+  size_t log_buffer_size;
+  int verbose;
+  int help;
+
+  ArcherFlags(const char *env);
+
+  /// Print all options with their types, defaults and descriptions.
+  void printHelp(std::ostream &os) const;
+
+  /// Print the value of every option after parsing.
+  void printValues(std::ostream &os) const;
+
+  /// Replace %p in a file name option by the process id.
+  static std::string expandPid(const std::string &name);
+
+private:
+  enum FlagType { FLAG_INT, FLAG_SIZE, FLAG_DOUBLE, FLAG_STRING, FLAG_ENUM };
+
+  struct Flag {
+    const char *Name;
+    FlagType Type;
+    void *Value;
+    const char *Help;
+    /// nullptr terminated list of names for FLAG_ENUM, the value is the index.
+    const char *const *Choices;
+    std::string Default;
+  };
+
+  void addFlag(const char *name, int *value, const char *help);
+  void addFlag(const char *name, size_t *value, const char *help);
+  void addFlag(const char *name, double *value, const char *help);
+  void addFlag(const char *name, std::string *value, const char *help);
+  void addFlag(const char *name, int *value, const char *const *choices,
+               const char *help);
+  void add(const char *name, FlagType type, void *value, const char *help,
+           const char *const *choices);
+
+  bool parse(const Flag &flag, const std::string &value);
+  std::string format(const Flag &flag) const;
+  static const char *typeName(const Flag &flag);
+
+  std::vector<Flag> Flags;
+};
+
+#endif // ARCHER_FLAGS_H
@@ -47,12 +47,18 @@ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <stddef.h>
+
 void __attribute__((weak)) AnnotateHappensAfter(const char *file, int line, const volatile void *cv){}
 void __attribute__((weak)) AnnotateHappensBefore(const char *file, int line, const volatile void *cv){}
 void __attribute__((weak)) AnnotateIgnoreWritesBegin(const char *file, int line){}
 void __attribute__((weak)) AnnotateIgnoreWritesEnd(const char *file, int line){}
+void __attribute__((weak)) AnnotateNewMemory(const char *file, int line, const volatile void *cv, size_t size){}
+void __attribute__((weak)) AnnotateBenignRaceSized(const char *file, int line, const volatile void *cv, size_t size, const char *description){}
 
 // This is a Fortran wrapper for TSan Annotation functions.
+// Fortran passes all arguments by reference. The archer_annotations module
+// in archer_annotations.f90 calls the Annotate functions directly instead.
 
 void annotatehappensafter_(const char *file, int* line, const volatile void *cv)
 {
@@ -61,7 +67,48 @@ void annotatehappensbefore_(const char *file, int *line, const volatile void *cv
 {
 AnnotateHappensBefore(file, *line, cv);
 }
-void annotateignorewritesbegin_(const char *file, int line)
-{AnnotateIgnoreWritesBegin(file, line);}
-void annotateignorewritesend_(const char *file, int line)
-{AnnotateIgnoreWritesEnd(file, line);}
+void annotateignorewritesbegin_(const char *file, int *line)
+{AnnotateIgnoreWritesBegin(file, *line);}
+void annotateignorewritesend_(const char *file, int *line)
+{AnnotateIgnoreWritesEnd(file, *line);}
+
+// Range annotations for the archer_annotations module. A strided array
+// section of count elements of size bytes, stride bytes apart, is
+// annotated with one call per element, or with a single call if the
+// section is contiguous.
+
+void archer_benign_race_range(const volatile void *addr, size_t bytes)
+{
+  AnnotateBenignRaceSized(__FILE__, __LINE__, addr, bytes, "archer_benign_race_range");
+}
+
+void archer_benign_race_strided(const volatile void *addr, size_t count,
+                                ptrdiff_t stride, size_t bytes)
+{
+  const volatile char *p = (const volatile char *)addr;
+  size_t i;
+  if (stride == (ptrdiff_t)bytes) {
+    archer_benign_race_range(p, count * bytes);
+    return;
+  }
+  for (i = 0; i < count; i++, p += stride)
+    AnnotateBenignRaceSized(__FILE__, __LINE__, p, bytes, "archer_benign_race_strided");
+}
+
+void archer_new_memory_range(const volatile void *addr, size_t bytes)
+{
+  AnnotateNewMemory(__FILE__, __LINE__, addr, bytes);
+}
+
+void archer_new_memory_strided(const volatile void *addr, size_t count,
+                               ptrdiff_t stride, size_t bytes)
+{
+  const volatile char *p = (const volatile char *)addr;
+  size_t i;
+  if (stride == (ptrdiff_t)bytes) {
+    archer_new_memory_range(p, count * bytes);
+    return;
+  }
+  for (i = 0; i < count; i++, p += stride)
+    AnnotateNewMemory(__FILE__, __LINE__, p, bytes);
+}
@@ -0,0 +1,137 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "live-stats.h"
+#include "rss.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+LiveStats::LiveStats(int period_ms, const RegionTracker *regions,
+                     bool reports_visible)
+    : Stats(nullptr), Period(period_ms),
+      Start(std::chrono::steady_clock::now()), Regions(regions), Stop(false) {
+  char name[32];
+  snprintf(name, sizeof(name), ARCHER_STATS_NAME, (int)getpid());
+  Name = name;
+
+  int fd = shm_open(name, O_CREAT | O_TRUNC | O_RDWR, 0600);
+  if (fd < 0)
+    return;
+  void *addr = MAP_FAILED;
+  if (ftruncate(fd, sizeof(ArcherLiveStats)) == 0)
+    addr = mmap(nullptr, sizeof(ArcherLiveStats), PROT_READ | PROT_WRITE,
+                MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    shm_unlink(name);
+    return;
+  }
+
+  // The segment is zero filled, readers ignore it until the magic is set.
+  Stats = (ArcherLiveStats *)addr;
+  Stats->version = ARCHER_STATS_VERSION;
+  Stats->pid = getpid();
+  Stats->period_ms = period_ms;
+  Stats->reports_visible = reports_visible;
+  Stats->max_threads = MAX_THREADS;
+  update();
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(Stats->magic, ARCHER_STATS_MAGIC, sizeof(Stats->magic));
+  Thread = std::thread(&LiveStats::run, this);
+}
+
+LiveStats::~LiveStats() {
+  if (!Stats)
+    return;
+  finish();
+  munmap(Stats, sizeof(ArcherLiveStats));
+  shm_unlink(Name.c_str());
+}
+
+void LiveStats::finish() {
+  if (!Thread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Stop = true;
+  }
+  Cond.notify_one();
+  Thread.join();
+  update();
+  Stats->finished = 1;
+}
+
+void LiveStats::run() {
+  std::unique_lock<std::mutex> Lock(Mutex);
+  while (!Stop) {
+    Cond.wait_for(Lock, Period, [this] { return Stop; });
+    update();
+  }
+}
+
+void LiveStats::update() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  Stats->rss_kb = get_current_rss();
+  Stats->max_rss_kb = usage.ru_maxrss;
+  Stats->heap_kb = get_current_heap();
+  archer_get_stats(&Stats->objects);
+
+  std::string region = Regions->format();
+  strncpy(Stats->region, region.c_str(), ARCHER_STATS_REGION_SIZE - 1);
+  Stats->time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - Start).count();
+}
@@ -0,0 +1,156 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Live statistics of a running Archer process.
+//
+// With live_stats=<period in ms> libarcher creates the POSIX shared memory
+// segment /archer.<pid> that holds an ArcherLiveStats. Every OpenMP thread
+// counts its callbacks directly in its slot of the segment. A background
+// thread updates the process wide values, including the bookkeeping memory
+// of archer_get_stats, once per period. archer-top maps the segment
+// read-only and shows the statistics without stopping the process.
+//
+// Nothing is synchronized, readers see a snapshot that may be slightly
+// inconsistent between fields.
+
+#ifndef ARCHER_LIVE_STATS_H
+#define ARCHER_LIVE_STATS_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "archer.h"
+#include "counter.h"
+#include "rss.h"
+
+#define ARCHER_STATS_MAGIC "ARCHSTA1"
+#define ARCHER_STATS_VERSION 2
+
+// Name of the segment of process pid, /dev/shm/archer.<pid> on Linux.
+#define ARCHER_STATS_NAME "/archer.%d"
+
+#define ARCHER_STATS_REGION_SIZE 256
+
+struct alignas(CACHE_LINE) ArcherThreadStats {
+  callback_counter_t Callbacks;
+};
+
+struct ArcherLiveStats {
+  char magic[8];
+  uint32_t version;
+  uint32_t pid;
+  // Period of the updates and the time of the last update since the start
+  // of the process in ms.
+  uint32_t period_ms;
+  uint32_t finished;
+  uint64_t time_ms;
+  uint64_t rss_kb;
+  uint64_t max_rss_kb;
+  // Heap of the application, 0 if not running under TSan.
+  uint64_t heap_kb;
+  // Race reports so far, only counted if reports_visible is set, i.e. if
+  // libarcher receives TSan's report hook.
+  uint64_t reports;
+  uint32_t reports_visible;
+  // Number of slots in threads, threads with a higher id are not counted.
+  uint32_t max_threads;
+  // Innermost parallel regions that are executing, separated by ';' and
+  // truncated to the size of the field.
+  char region[ARCHER_STATS_REGION_SIZE];
+  struct archer_stats objects;
+  ArcherThreadStats threads[MAX_THREADS];
+};
+
+/// Owner of the segment in the running process. The background thread
+/// starts with the constructor and is stopped by finish().
+class LiveStats {
+public:
+  LiveStats(int period_ms, const RegionTracker *regions,
+            bool reports_visible);
+  /// Removes the segment.
+  ~LiveStats();
+
+  bool isOpen() const { return Stats != nullptr; }
+  const std::string &name() const { return Name; }
+
+  /// Slot of thread id, nullptr if there are more threads than slots.
+  ArcherThreadStats *thread(uint64_t id) {
+    return id < MAX_THREADS ? &Stats->threads[id] : nullptr;
+  }
+
+  void report() {
+    __atomic_fetch_add(&Stats->reports, 1, __ATOMIC_RELAXED);
+  }
+
+  /// Stop the updates, write the final values and mark the process finished.
+  void finish();
+
+private:
+  void run();
+  void update();
+
+  std::string Name;
+  ArcherLiveStats *Stats;
+  std::chrono::milliseconds Period;
+  std::chrono::steady_clock::time_point Start;
+  const RegionTracker *Regions;
+
+  std::mutex Mutex;
+  std::condition_variable Cond;
+  bool Stop;
+  std::thread Thread;
+};
+
+#endif // ARCHER_LIVE_STATS_H
@@ -0,0 +1,131 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "modules.h"
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <elf.h>
+#include <unistd.h>
+
+#ifndef NT_GNU_BUILD_ID
+#define NT_GNU_BUILD_ID 3
+#endif
+
+namespace {
+struct ModuleQuery {
+  uintptr_t Addr;
+  LoadedModule *Module;
+  bool Found;
+};
+}
+
+static int findModuleCallback(struct dl_phdr_info *info, size_t size,
+                              void *data) {
+  ModuleQuery *Query = static_cast<ModuleQuery *>(data);
+  for (int i = 0; i < info->dlpi_phnum; i++) {
+    const ElfW(Phdr) &Phdr = info->dlpi_phdr[i];
+    uintptr_t Start = info->dlpi_addr + Phdr.p_vaddr;
+    if (Phdr.p_type == PT_LOAD &&
+        Query->Addr >= Start && Query->Addr < Start + Phdr.p_memsz) {
+      Query->Module->Base = info->dlpi_addr;
+      Query->Module->Phdr = info->dlpi_phdr;
+      Query->Module->Phnum = info->dlpi_phnum;
+      Query->Module->Name = info->dlpi_name;
+      Query->Found = true;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+bool findModule(uintptr_t Addr, LoadedModule &Module) {
+  ModuleQuery Query = {Addr, &Module, false};
+  return dl_iterate_phdr(findModuleCallback, &Query) && Query.Found;
+}
+
+std::string readBuildId(const LoadedModule &Module) {
+  for (int i = 0; i < Module.Phnum; i++) {
+    const ElfW(Phdr) &Phdr = Module.Phdr[i];
+    if (Phdr.p_type != PT_NOTE)
+      continue;
+    const char *Note = reinterpret_cast<const char *>(Module.Base + Phdr.p_vaddr);
+    const char *End = Note + Phdr.p_memsz;
+    while (Note + sizeof(ElfW(Nhdr)) <= End) {
+      const ElfW(Nhdr) *Header = reinterpret_cast<const ElfW(Nhdr) *>(Note);
+      const char *Name = Note + sizeof(ElfW(Nhdr));
+      const unsigned char *Desc = reinterpret_cast<const unsigned char *>(
+          Name + ((Header->n_namesz + 3) & ~3));
+      if (Header->n_type == NT_GNU_BUILD_ID && Header->n_namesz == 4 &&
+          memcmp(Name, "GNU", 4) == 0) {
+        std::string Id;
+        char Hex[3];
+        for (unsigned j = 0; j < Header->n_descsz; j++) {
+          snprintf(Hex, sizeof(Hex), "%02x", Desc[j]);
+          Id += Hex;
+        }
+        return Id;
+      }
+      Note = reinterpret_cast<const char *>(Desc) + ((Header->n_descsz + 3) & ~3);
+    }
+  }
+  return std::string();
+}
+
+std::string modulePath(const LoadedModule &Module) {
+  if (Module.Name && Module.Name[0])
+    return Module.Name;
+  char Path[PATH_MAX];
+  ssize_t Len = readlink("/proc/self/exe", Path, sizeof(Path) - 1);
+  if (Len <= 0)
+    return std::string();
+  Path[Len] = '\0';
+  return Path;
+}
@@ -47,19 +47,29 @@ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include "archer.h"
+#include "archer-log.h"
+#include "clean-regions.h"
 #include "counter.h"
+#include "flags.h"
+#include "live-stats.h"
+#include "report-log.h"
+#include "rss.h"
 
 #ifndef __STDC_FORMAT_MACROS
 #define __STDC_FORMAT_MACROS
 #endif
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <inttypes.h>
 #include <iostream>
 #include <mutex>
+#include <new>
 #include <sstream>
 #include <stack>
 #include <string>
@@ -67,60 +77,172 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <unordered_map>
 #include <vector>
 
+#include <dlfcn.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
+#include <unistd.h>
+#if ARCHER_HAVE_LIBNUMA
+#include <numa.h>
+#endif
 #define _OPENMP
 #include "omp.h"
 #if !defined(__powerpc64__)
 #include <ompt.h>
 #endif
 
-callback_counter_t *all_counter;
+callback_counter_t **all_counter;
 __thread callback_counter_t* this_event_counter;
 
-class ArcherFlags {
-public:
 #if (LLVM_VERSION) >= 40
-  int flush_shadow;
+extern "C" {
+  int __attribute__((weak)) __swordomp__get_omp_status();
+  void __attribute__((weak)) __swordomp__add_omp_status(int);
+  void __attribute__((weak)) __tsan_flush_memory() {}
+}
 #endif
-  int print_ompt_counters;
-  int print_max_rss;
 
-  ArcherFlags(const char *env) :
-#if (LLVM_VERSION) >= 40
-    flush_shadow(0),
-#endif
-    print_ompt_counters(0),
-    print_max_rss(0) {
-    if(env) {
-      std::vector<std::string> tokens;
-      std::string token;
-      std::string str(env);
-      std::istringstream iss(str);
-      while(std::getline(iss, token, ' '))
-        tokens.push_back(token);
-
-      int ret;
-      for (std::vector<std::string>::iterator it = tokens.begin(); it != tokens.end(); ++it) {
+// Defined by the Archer pass if the application was compiled for offline
+// analysis (-archer-offline). Its accesses are then logged instead of being
+// checked by TSan.
+extern "C" int __attribute__((weak)) __archer_offline_build;
+
+/// Ids of tasks and parallel regions in the offline log, 0 means none.
+static std::atomic<uint64_t> next_log_id(1);
+
+/// Log id of the task the current thread is executing.
+__thread uint64_t current_log_task;
+ArcherFlags *archer_flags;
+
+/// Code pointers of the innermost parallel region of every thread, only
+/// maintained if track_region is set, i.e. while the RSS sampler or the live
+/// statistics are running.
+static RegionTracker active_regions;
+/// Slot of the current thread in active_regions, nullptr if it has none.
+static __thread std::atomic<const void*> *current_region;
+static bool track_region;
+static RssSampler *rss_sampler;
+
+/// Shared memory segment with the live statistics, only set if live_stats
+/// is enabled.
+static LiveStats *live_stats;
+
+/// File of the race reports of this process, only set if report_dir is set.
+static ReportLog *report_log;
+
+/// Bookkeeping objects reported by archer_get_stats.
+enum ObjectKind {
+  OBJ_PARALLEL_DATA,
+  OBJ_TASK_DATA,
+  OBJ_TASKGROUP,
+  OBJ_DEPENDENCES,
+  OBJ_KINDS
+};
+
+/// Objects are created and deleted on different threads all the time. To
+/// avoid contention, every thread collects its changes and adds them to
+/// the totals once they reach OBJ_BATCH objects.
+#define OBJ_BATCH 64
+
+struct ObjectTotals {
+  std::atomic<int64_t> Count;
+  std::atomic<int64_t> Bytes;
+  std::atomic<int64_t> PeakCount;
+  std::atomic<int64_t> PeakBytes;
+  std::atomic<int64_t> PooledCount;
+  std::atomic<int64_t> PooledBytes;
+};
+
+struct ObjectDelta {
+  int64_t Count;
+  int64_t Bytes;
+};
+
+static ObjectTotals object_totals[OBJ_KINDS];
+static __thread ObjectDelta object_delta[OBJ_KINDS];
+
+static inline void update_peak(std::atomic<int64_t> &Peak, int64_t value) {
+  int64_t old = Peak.load(std::memory_order_relaxed);
+  while (value > old &&
+         !Peak.compare_exchange_weak(old, value, std::memory_order_relaxed))
+    ;
+}
+
+static void flush_objects(int kind) {
+  ObjectDelta &D = object_delta[kind];
+  ObjectTotals &T = object_totals[kind];
+  int64_t count = T.Count.fetch_add(D.Count, std::memory_order_relaxed) + D.Count;
+  int64_t bytes = T.Bytes.fetch_add(D.Bytes, std::memory_order_relaxed) + D.Bytes;
+  if (D.Count > 0) {
+    update_peak(T.PeakCount, count);
+    update_peak(T.PeakBytes, bytes);
+  }
+  D.Count = 0;
+  D.Bytes = 0;
+}
+
+static inline void count_objects(int kind, int n, size_t bytes) {
+  ObjectDelta &D = object_delta[kind];
+  D.Count += n;
+  D.Bytes += n * (int64_t)bytes;
+  if (D.Count >= OBJ_BATCH || D.Count <= -OBJ_BATCH)
+    flush_objects(kind);
+}
+
+static inline void count_pooled(int kind, int n, size_t bytes) {
+  object_totals[kind].PooledCount.fetch_add(n, std::memory_order_relaxed);
+  object_totals[kind].PooledBytes.fetch_add(n * (int64_t)bytes,
+                                            std::memory_order_relaxed);
+}
+
+/// Regions that earlier runs checked without a report, only set if
+/// clean_regions is enabled.
+static CleanRegionDB *clean_regions;
+
+/// Number of implicit tasks on this thread's stack that run unchecked.
+static __thread int skip_checks;
+
+/// Added to __swordomp_status__ while a clean region runs, so that the
+/// uninstrumented versions of the functions it calls are selected.
+#define ARCHER_SKIP_STATUS (1 << 20)
+
 #if (LLVM_VERSION) >= 40
-        ret = sscanf(it->c_str(), "flush_shadow=%d", &flush_shadow);
-#endif
-        ret = sscanf(it->c_str(), "print_ompt_counters=%d", &print_ompt_counters);
-        ret = sscanf(it->c_str(), "print_max_rss=%d", &print_max_rss);
-        if(ret) {
-          std::cerr << "Illegal values for ARCHER_OPTIONS variable: " << token << std::endl;
-        }
-      }
-    }
+/// Decides at the end of which outermost parallel regions the shadow memory
+/// is flushed. By default (flush_every=1) this is every region; the other
+/// triggers restrict flushing to when it is actually needed. Outermost
+/// regions of different application threads may end concurrently, so the
+/// state is protected by a mutex.
+class FlushPolicy {
+  std::mutex Mutex;
+  int RegionsSinceFlush;
+  std::chrono::steady_clock::time_point LastFlush;
+
+public:
+  FlushPolicy() : RegionsSinceFlush(0), LastFlush(std::chrono::steady_clock::now())
+  {}
+
+  /// Whether to flush at the end of this region. A positive answer resets
+  /// the triggers, so only one of the concurrently ending regions flushes.
+  bool shouldFlush() {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    if (++RegionsSinceFlush < archer_flags->flush_every)
+      return false;
+    if (archer_flags->flush_interval > 0 &&
+        std::chrono::steady_clock::now() - LastFlush <
+        std::chrono::milliseconds(archer_flags->flush_interval))
+      return false;
+    // Reading the RSS needs a system call, so check it last.
+    if (archer_flags->flush_max_rss > 0 &&
+        get_current_rss() < (size_t)archer_flags->flush_max_rss * 1024)
+      return false;
+    RegionsSinceFlush = 0;
+    LastFlush = std::chrono::steady_clock::now();
+    return true;
   }
 };
 
-#if (LLVM_VERSION) >= 40
-extern "C" {
-  int __attribute__((weak)) __swordomp__get_omp_status();
-  void __attribute__((weak)) __tsan_flush_memory() {}
-}
+// Used by the threads ending an outermost parallel region.
+static FlushPolicy flush_policy;
 #endif
-ArcherFlags *archer_flags;
 
 // The following definitions are pasted from "llvm/Support/Compiler.h" to allow the code
 // to be compiled with other compilers like gcc:
@@ -132,12 +254,32 @@ ArcherFlags *archer_flags;
 extern "C" {
 void __attribute__((weak)) AnnotateHappensAfter(const char *file, int line, const volatile void *cv){}
 void __attribute__((weak)) AnnotateHappensBefore(const char *file, int line, const volatile void *cv){}
+void __attribute__((weak)) AnnotateIgnoreReadsBegin(const char *file, int line){}
+void __attribute__((weak)) AnnotateIgnoreReadsEnd(const char *file, int line){}
 void __attribute__((weak)) AnnotateIgnoreWritesBegin(const char *file, int line){}
 void __attribute__((weak)) AnnotateIgnoreWritesEnd(const char *file, int line){}
 
 void __attribute__((weak)) AnnotateNewMemory(const char *file, int line, const volatile void *cv, size_t size){}
 }
 
+#if ARCHER_DIRECT_TSAN
+// Happens-before arcs go directly to __tsan_release and __tsan_acquire,
+// resolved once in ompt_tsan_initialize. Unlike the Annotate functions they
+// take no file and line and do not add a function entry and exit to the
+// trace of the thread. Before initialization, and if the TSan runtime is
+// too old to provide them, the Annotate functions are called instead.
+static void annotateRelease(void *cv) {
+  AnnotateHappensBefore(__FILE__, __LINE__, cv);
+}
+static void annotateAcquire(void *cv) {
+  AnnotateHappensAfter(__FILE__, __LINE__, cv);
+}
+static void (*tsan_release)(void *) = annotateRelease;
+static void (*tsan_acquire)(void *) = annotateAcquire;
+
+# define TsanHappensBefore(cv) tsan_release((void *)(cv))
+# define TsanHappensAfter(cv) tsan_acquire((void *)(cv))
+#else
 // This marker is used to define a happens-before arc. The race detector will
 // infer an arc from the begin to the end when they share the same pointer
 // argument.
@@ -145,6 +287,13 @@ void __attribute__((weak)) AnnotateNewMemory(const char *file, int line, const v
 
 // This marker defines the destination of a happens-before arc.
 # define TsanHappensAfter(cv) AnnotateHappensAfter(__FILE__, __LINE__, cv)
+#endif
+
+// Ignore any races on reads between here and the next TsanIgnoreReadsEnd.
+# define TsanIgnoreReadsBegin() AnnotateIgnoreReadsBegin(__FILE__, __LINE__)
+
+// Resume checking for racy reads.
+# define TsanIgnoreReadsEnd() AnnotateIgnoreReadsEnd(__FILE__, __LINE__)
 
 // Ignore any races on writes between here and the next TsanIgnoreWritesEnd.
 # define TsanIgnoreWritesBegin() AnnotateIgnoreWritesBegin(__FILE__, __LINE__)
@@ -177,84 +326,315 @@ static uint64_t my_next_id()
   return ret;
 }
 
+#if ARCHER_HAVE_LIBNUMA
+static bool archer_numa_available;
+#endif
+
+// Smallest allocation for which libnuma is asked for node-local memory.
+// numa_alloc_local maps every allocation separately, so smaller ones would
+// cost a system call and a memory mapping each.
+#define ARCHER_NUMA_MIN_SIZE (64 * 1024)
+
+// Per-thread data should live on the NUMA node of the thread using it. With
+// libnuma we ask for node-local memory explicitly for large allocations,
+// otherwise we rely on the first-touch policy: the calling thread writes the
+// memory before anyone else.
+static void *allocLocal(size_t size) {
+#if ARCHER_HAVE_LIBNUMA
+  if (archer_numa_available && size >= ARCHER_NUMA_MIN_SIZE)
+    return numa_alloc_local(size);
+#endif
+  void *ret;
+  if (posix_memalign(&ret, CACHE_LINE, size))
+    return nullptr;
+  std::memset(ret, 0, size);
+  return ret;
+}
+
+static void freeLocal(void *ptr, size_t size) {
+#if ARCHER_HAVE_LIBNUMA
+  if (archer_numa_available && size >= ARCHER_NUMA_MIN_SIZE) {
+    numa_free(ptr, size);
+    return;
+  }
+#endif
+  free(ptr);
+}
+
+// Like allocLocal, but the memory is mapped directly, so that freePages
+// returns it to the operating system instead of to the heap. The memory is
+// mapped separately anyway, so libnuma is used for any size.
+static void *allocPages(size_t size) {
+#if ARCHER_HAVE_LIBNUMA
+  if (archer_numa_available)
+    return numa_alloc_local(size);
+#endif
+  void *ret = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return ret == MAP_FAILED ? nullptr : ret;
+}
+
+static void freePages(void *ptr, size_t size) {
+#if ARCHER_HAVE_LIBNUMA
+  if (archer_numa_available) {
+    numa_free(ptr, size);
+    return;
+  }
+#endif
+  munmap(ptr, size);
+}
+
+// Minimal size of a block allocated by a DataPool. The owner touches the
+// block first, so whole pages of it end up on the owner's NUMA node.
+#define DP_BLOCK_SIZE 4096
+
+// Minimal size of a block if pools are trimmed (pool_trim > 0). Blocks are
+// mapped separately then, and with libnuma bound to the owner's node, larger
+// blocks keep the number of mappings low.
+#define DP_TRIM_BLOCK_SIZE ARCHER_NUMA_MIN_SIZE
+
+// Number of blocks a pool keeps when it is trimmed.
+#define DP_TRIM_MIN_BLOCKS 1
+
+// Highest number of trim points a pool skips after trims that released
+// nothing or had to be undone by allocating again.
+#define DP_TRIM_MAX_BACKOFF 64
+
+// Number of objects a thread may retire to other threads' pools before it
+// hands them back without waiting for the next reclamation point.
+#define DP_RETIRE_LIMIT 1024
+
 // Data structure to provide a threadsafe pool of reusable objects.
 // DataPool<Type of objects, Size of blockalloc>
 template <typename T, int N>
 struct DataPool {
   std::mutex DPMutex;
+  // Free objects, only accessed by the owning thread.
   std::stack<T *> DataPointer;
+  // Objects returned in bulk by other threads, protected by DPMutex. The owner
+  // only takes them over once DataPointer has run empty.
+  std::vector<T *> RemoteDataPointer;
   int total;
+  // Id of the owning thread, used to index the other threads' RetireLists.
+  int Owner;
+
+  // prefix the Data with a pointer to 'this', allows to return memory to 'this',
+  // without explicitly knowing the source.
+  struct pooldata {DataPool<T,N>* dp; T data;};
+
+  // Whether blocks are mapped separately and released by trim(). Only then
+  // the blocks and their number of objects are recorded.
+  bool Trim;
+  std::vector<pooldata *> Blocks;
+  int BlockObjects;
+  // Trim points to skip before the next scan, and the number skipped after
+  // the last one. The backoff doubles while scans release nothing or the
+  // pool grows back after a release, which bounds the cost of scanning and
+  // of remapping the blocks for programs that stay above the threshold.
+  int TrimSkip;
+  int TrimBackoff;
+  // Objects of the pool after the last release of blocks, -1 if none.
+  int TrimmedTotal;
 
 
   void newDatas(){
-    // prefix the Data with a pointer to 'this', allows to return memory to 'this',
-    // without explicitly knowing the source.
-    //
     // To reduce lock contention, we use thread local DataPools, but Data objects move to other threads.
-    // The strategy is to get objects from local pool. Only if the object moved to another
-    // thread, we might see a penalty on release (returnData).
+    // The strategy is to get objects from local pool. Objects that moved to another
+    // thread are retired there and only returned in bulk at a reclamation point
+    // (see RetireList), so the owner never takes the lock on its fast path.
     // For "single producer" pattern, a single thread creates tasks, these are executed by other threads.
     // The master will have a high demand on TaskData, so return after use.
-    struct pooldata {DataPool<T,N>* dp; T data;};
-    // We alloc without initialize the memory. We cannot call constructors. Therfore use malloc!
-    pooldata* datas = (pooldata*) malloc(sizeof(pooldata) * N);
-    for (int i = 0; i<N; i++) {
+    int n = N;
+    size_t block_size = Trim ? DP_TRIM_BLOCK_SIZE : DP_BLOCK_SIZE;
+    if (n * sizeof(pooldata) < block_size)
+      n = block_size / sizeof(pooldata);
+    // We alloc without initialize the memory. We cannot call constructors.
+    // newDatas is always called by the owning thread, so the block is placed
+    // on the owner's NUMA node.
+    pooldata* datas;
+    if (Trim) {
+      datas = (pooldata*) allocPages(sizeof(pooldata) * n);
+      Blocks.push_back(datas);
+      BlockObjects = n;
+    } else
+      datas = (pooldata*) allocLocal(sizeof(pooldata) * n);
+    for (int i = 0; i<n; i++) {
       datas[i].dp = this;
       DataPointer.push(&(datas[i].data));
     }
-    total+=N;
+    total+=n;
+    count_pooled(T::StatsKind, n, sizeof(pooldata));
+  }
+
+  // Take over the objects other threads have returned so far.
+  void reclaimRemoteDatas() {
+    DPMutex.lock();
+    for (typename std::vector<T *>::iterator it = RemoteDataPointer.begin();
+         it != RemoteDataPointer.end(); ++it)
+      DataPointer.push(*it);
+    RemoteDataPointer.clear();
+    DPMutex.unlock();
   }
 
+  // Must only be called by the owning thread.
   T * getData() {
     T * ret;
-    DPMutex.lock();
-    if (DataPointer.empty())
-      newDatas();
+    if (DataPointer.empty()) {
+      reclaimRemoteDatas();
+      if (DataPointer.empty())
+        newDatas();
+    }
     ret=DataPointer.top();
     DataPointer.pop();
-    DPMutex.unlock();
     return ret;
   }
 
+  // Must only be called by the owning thread.
   void returnData(T * data) {
-    DPMutex.lock();
     DataPointer.push(data);
-    DPMutex.unlock();
   }
 
+  // Must only be called by the owning thread.
   void getDatas(int n, T** datas) {
-    DPMutex.lock();
-    for (int i=0; i<n; i++) {
-      if (DataPointer.empty())
-        newDatas();
-      datas[i]=DataPointer.top();
-      DataPointer.pop();
-    }
-    DPMutex.unlock();
+    for (int i=0; i<n; i++)
+      datas[i]=getData();
   }
 
+  // Used by other threads to return objects to this pool.
   void returnDatas(int n, T** datas) {
     DPMutex.lock();
-    for (int i=0; i<n; i++) {
-      DataPointer.push(datas[i]);
-    }
+    RemoteDataPointer.insert(RemoteDataPointer.end(), datas, datas + n);
     DPMutex.unlock();
   }
 
-  DataPool() : DataPointer(), DPMutex(), total(0)
+  // Release the blocks of which all objects are free, if more than the
+  // given fraction of the pool is free. Must only be called by the owning
+  // thread. Objects other threads still hold back are not free, so this
+  // works best when all threads are quiescent.
+  void trim(double threshold) {
+    if (!Trim || Blocks.size() <= DP_TRIM_MIN_BLOCKS)
+      return;
+    if (TrimSkip > 0) {
+      TrimSkip--;
+      return;
+    }
+    reclaimRemoteDatas();
+    if (DataPointer.size() <= threshold * total)
+      return;
+
+    // Count the free objects per block.
+    std::sort(Blocks.begin(), Blocks.end());
+    std::vector<T *> Free;
+    std::vector<size_t> FreeBlock;
+    std::vector<int> FreeCount(Blocks.size(), 0);
+    Free.reserve(DataPointer.size());
+    FreeBlock.reserve(DataPointer.size());
+    while (!DataPointer.empty()) {
+      T *data = DataPointer.top();
+      DataPointer.pop();
+      size_t block = std::upper_bound(Blocks.begin(), Blocks.end(),
+                                      (pooldata *)data) - Blocks.begin() - 1;
+      Free.push_back(data);
+      FreeBlock.push_back(block);
+      FreeCount[block]++;
+    }
+
+    std::vector<bool> Release(Blocks.size(), false);
+    size_t kept = Blocks.size();
+    for (size_t i = 0; i < Blocks.size() && kept > DP_TRIM_MIN_BLOCKS; i++) {
+      if (FreeCount[i] == BlockObjects) {
+        Release[i] = true;
+        kept--;
+      }
+    }
+    for (size_t i = 0; i < Free.size(); i++)
+      if (!Release[FreeBlock[i]])
+        DataPointer.push(Free[i]);
+
+    size_t j = 0;
+    for (size_t i = 0; i < Blocks.size(); i++) {
+      if (Release[i])
+        freePages(Blocks[i], sizeof(pooldata) * BlockObjects);
+      else
+        Blocks[j++] = Blocks[i];
+    }
+    int released = (Blocks.size() - j) * BlockObjects;
+    Blocks.resize(j);
+    bool regrown = TrimmedTotal >= 0 && total > TrimmedTotal;
+    total -= released;
+    count_pooled(T::StatsKind, -released, sizeof(pooldata));
+
+    if (!released || regrown)
+      TrimBackoff = std::min(2 * TrimBackoff, DP_TRIM_MAX_BACKOFF);
+    else
+      TrimBackoff = 1;
+    TrimSkip = TrimBackoff - 1;
+    if (released)
+      TrimmedTotal = total;
+  }
+
+  DataPool(int Owner) : DataPointer(), RemoteDataPointer(), DPMutex(), total(0),
+    Owner(Owner), Trim(archer_flags->pool_trim > 0),
+    BlockObjects(0), TrimSkip(0), TrimBackoff(1), TrimmedTotal(-1)
   {}
 
 };
 
+// Per-thread list of objects that were released by this thread but belong to
+// the DataPool of another thread. Instead of returning every object to its
+// owner immediately, they are collected per owner and handed back in bulk at
+// reclamation points (barriers and the end of implicit tasks), or once the
+// thread has retired DP_RETIRE_LIMIT objects.
+template <typename T, int N>
+struct RetireList {
+  // Indexed by DataPool::Owner.
+  std::vector<DataPool<T,N>*> Pools;
+  std::vector<std::vector<T *> > Datas;
+  int Count;
+
+  RetireList() : Pools(), Datas(), Count(0)
+  {}
+
+  void retire(DataPool<T,N>* Pool, T * data) {
+    if (Pool->Owner >= (int)Pools.size()) {
+      Pools.resize(Pool->Owner + 1, nullptr);
+      Datas.resize(Pool->Owner + 1);
+    }
+    Pools[Pool->Owner] = Pool;
+    Datas[Pool->Owner].push_back(data);
+    if (++Count >= DP_RETIRE_LIMIT)
+      reclaim();
+  }
+
+  void reclaim() {
+    if (Count == 0)
+      return;
+    for (size_t i = 0; i < Datas.size(); i++) {
+      if (!Datas[i].empty()) {
+        Pools[i]->returnDatas(Datas[i].size(), Datas[i].data());
+        Datas[i].clear();
+      }
+    }
+    Count = 0;
+  }
+};
+
 // This function takes care to return the data to the originating DataPool
 // A pointer to the originating DataPool is stored just before the actual data.
+// Data owned by another thread is retired and returned at the next
+// reclamation point.
 template <typename T, int N>
-  static void retData(void * data) {
-    ((DataPool<T,N>**)data)[-1]->returnData((T*)data);
+  static void retData(void * data, DataPool<T,N>* Local, RetireList<T,N>* Retired) {
+    DataPool<T,N>* Pool = ((DataPool<T,N>**)data)[-1];
+    if (Pool == Local)
+      Pool->returnData((T*)data);
+    else
+      Retired->retire(Pool, (T*)data);
   }
 
 struct ParallelData;
 __thread DataPool<ParallelData,4> *pdp;
+__thread RetireList<ParallelData,4> *pdrl;
 
 /// Data structure to store additional information for parallel regions.
 struct ParallelData {
@@ -264,6 +644,26 @@ struct ParallelData {
   /// Two addresses for relationships with barriers.
   ompt_tsan_clockid Barrier[2];
 
+  /// Return address of the runtime call that started this region.
+  const void *codeptr_ra;
+
+  /// Offline log id of this region, of the encountering task and the
+  /// encountering task's barrier epoch.
+  uint64_t LogId;
+  uint64_t LogParent;
+  uint64_t LogParentEpoch;
+
+  /// Entry of this region in the clean region database, if any, and whether
+  /// its implicit tasks run unchecked.
+  CleanRegion *Region;
+  bool SkipChecks;
+
+  static const int StatsKind = OBJ_PARALLEL_DATA;
+
+  ParallelData(const void *codeptr_ra) : codeptr_ra(codeptr_ra),
+    Region(nullptr), SkipChecks(false) {
+  }
+
   void *GetParallelPtr() {
     return &(Barrier[1]);
   }
@@ -278,10 +678,12 @@ struct ParallelData {
   }
   // overload new/delete to use DataPool for memory management.
   void * operator new(size_t size){
+    count_objects(StatsKind, 1, size);
     return pdp->getData();
   }
   void operator delete(void* p, size_t){
-    retData<ParallelData,4>(p);
+    count_objects(StatsKind, -1, sizeof(ParallelData));
+    retData<ParallelData,4>(p, pdp, pdrl);
   }
 };
 
@@ -291,6 +693,7 @@ static inline ParallelData *ToParallelData(ompt_data_t* parallel_data) {
 
 struct Taskgroup;
 __thread DataPool<Taskgroup,4> *tgp;
+__thread RetireList<Taskgroup,4> *tgrl;
 
 /// Data structure to support stacking of taskgroups and allow synchronization.
 struct Taskgroup {
@@ -300,6 +703,8 @@ struct Taskgroup {
   /// Reference to the parent taskgroup.
   Taskgroup* Parent;
 
+  static const int StatsKind = OBJ_TASKGROUP;
+
   Taskgroup(Taskgroup* Parent) : Parent(Parent) {
   }
   ~Taskgroup() {
@@ -311,15 +716,18 @@ struct Taskgroup {
   }
   // overload new/delete to use DataPool for memory management.
   void * operator new(size_t size){
+    count_objects(StatsKind, 1, size);
     return tgp->getData();
   }
   void operator delete(void* p, size_t){
-    retData<Taskgroup,4>(p);
+    count_objects(StatsKind, -1, sizeof(Taskgroup));
+    retData<Taskgroup,4>(p, tgp, tgrl);
   }
 };
 
 struct TaskData;
 __thread DataPool<TaskData,4> *tdp;
+__thread RetireList<TaskData,4> *tdrl;
 
 /// Data structure to store additional information for tasks.
 struct TaskData {
@@ -367,8 +775,37 @@ struct TaskData {
   int execution;
   int freed;
 
+  /// Offline log id of this task.
+  uint64_t LogId;
+
+  /// Number of barriers this implicit task has completed.
+  uint64_t LogEpoch;
+
+  /// Log id of the task the thread executed before this implicit task.
+  uint64_t LogPrev;
+
+  /// Number of children that completed since the last taskwait. The taskwait
+  /// only needs a happens-before edge if some child released it.
+  std::atomic_int ReleasedChildren;
+
+  /// Thread that created this task and thread that executed it last. Thread is
+  /// read by the thread that resumes the task.
+  int CreatorThread;
+  std::atomic_int Thread;
+
+  /// Whether this task has completed. Its children cannot synchronize with a
+  /// taskwait of this task anymore.
+  std::atomic_bool Completed;
+
+  /// Whether this implicit task disabled checking on its thread.
+  bool SkipChecks;
+
+  static const int StatsKind = OBJ_TASK_DATA;
+
   TaskData(TaskData* Parent) : InBarrier(false), Included(false), BarrierIndex(0),
-    RefCount(1), Parent(Parent), ImplicitTask(nullptr), Team(Parent->Team), TaskGroup(nullptr), DependencyCount(0), execution(0), freed(0) {
+    RefCount(1), Parent(Parent), ImplicitTask(nullptr), Team(Parent->Team), TaskGroup(nullptr), DependencyCount(0), execution(0), freed(0), LogId(0), LogEpoch(0), LogPrev(0),
+    ReleasedChildren(0),
+    CreatorThread(tdp->Owner), Thread(tdp->Owner), Completed(false), SkipChecks(false) {
     if (Parent != nullptr) {
       Parent->RefCount++;
       // Copy over pointer to taskgroup. This task may set up its own stack
@@ -378,7 +815,9 @@ struct TaskData {
   }
 
   TaskData(ParallelData* Team = nullptr) : InBarrier(false), Included(false), BarrierIndex(0),
-    RefCount(1), Parent(nullptr), ImplicitTask(this), Team(Team), TaskGroup(nullptr), DependencyCount(0), execution(1), freed(0) {
+    RefCount(1), Parent(nullptr), ImplicitTask(this), Team(Team), TaskGroup(nullptr), DependencyCount(0), execution(1), freed(0), LogId(0), LogEpoch(0), LogPrev(0),
+    ReleasedChildren(0),
+    CreatorThread(tdp->Owner), Thread(tdp->Owner), Completed(false), SkipChecks(false) {
   }
 
   ~TaskData() {
@@ -395,10 +834,12 @@ struct TaskData {
   }
   // overload new/delete to use DataPool for memory management.
   void * operator new(size_t size){
+    count_objects(StatsKind, 1, size);
     return tdp->getData();
   }
   void operator delete(void* p, size_t){
-    retData<TaskData,4>(p);
+    count_objects(StatsKind, -1, sizeof(TaskData));
+    retData<TaskData,4>(p, tdp, tdrl);
   }
 };
 
@@ -411,6 +852,23 @@ union OMPTData{
   TaskData td;
 };
 
+/// Hand back all objects this thread has retired to other threads' pools.
+static inline void reclaimRetiredData() {
+  pdrl->reclaim();
+  tgrl->reclaim();
+  tdrl->reclaim();
+}
+
+/// Number of implicit tasks on this thread's stack. When it drops to 0 the
+/// thread leaves an outermost parallel region and its pools are trimmed.
+static __thread int implicit_task_depth;
+
+static void trimPools() {
+  pdp->trim(archer_flags->pool_trim);
+  tgp->trim(archer_flags->pool_trim);
+  tdp->trim(archer_flags->pool_trim);
+}
+
 static inline TaskData *ToTaskData(ompt_data_t *task_data) {
   return reinterpret_cast<TaskData*>(task_data->ptr);
 }
@@ -433,23 +891,80 @@ static inline void* ToWaitPtr(ompt_wait_id_t wait_id) {
   return reinterpret_cast<void*>(wait_id);
 }
 
+static void get_object_stats(archer_object_stats *stats, int kind) {
+  ObjectTotals &T = object_totals[kind];
+  // Deletions may be added before the corresponding creations.
+  stats->count = std::max<int64_t>(T.Count.load(std::memory_order_relaxed), 0);
+  stats->bytes = std::max<int64_t>(T.Bytes.load(std::memory_order_relaxed), 0);
+  stats->peak_count = T.PeakCount.load(std::memory_order_relaxed);
+  stats->peak_bytes = T.PeakBytes.load(std::memory_order_relaxed);
+  stats->pooled_count = T.PooledCount.load(std::memory_order_relaxed);
+  stats->pooled_bytes = T.PooledBytes.load(std::memory_order_relaxed);
+}
+
+extern "C" int archer_get_stats(struct archer_stats *stats) {
+  if (!archer_flags)
+    return -1;
+  // The changes of the other threads are at most OBJ_BATCH objects behind.
+  for (int kind = 0; kind < OBJ_KINDS; kind++)
+    flush_objects(kind);
+  get_object_stats(&stats->parallel_data, OBJ_PARALLEL_DATA);
+  get_object_stats(&stats->task_data, OBJ_TASK_DATA);
+  get_object_stats(&stats->taskgroup, OBJ_TASKGROUP);
+  // Dependence arrays are allocated with new, not pooled.
+  get_object_stats(&stats->dependences, OBJ_DEPENDENCES);
+  stats->dependences.pooled_count = stats->dependences.count;
+  stats->dependences.pooled_bytes = stats->dependences.bytes;
+
+  // Entries of Locks are never removed. Every node of the hash table holds
+  // the entry, the next pointer and the cached hash.
+  LocksMutex.lock();
+  uint64_t locks = Locks.size();
+  uint64_t buckets = Locks.bucket_count();
+  LocksMutex.unlock();
+  uint64_t bytes = locks * (sizeof(std::pair<const ompt_wait_id_t, std::mutex>) +
+                            sizeof(void*) + sizeof(size_t)) +
+                   buckets * sizeof(void*);
+  stats->locks.count = stats->locks.peak_count = stats->locks.pooled_count = locks;
+  stats->locks.bytes = stats->locks.peak_bytes = stats->locks.pooled_bytes = bytes;
+  return 0;
+}
+
+
+static void init_event_counter(uint64_t thread) {
+  // With live statistics the counters are kept in the shared memory segment.
+  ArcherThreadStats *stats;
+  if(live_stats && (stats = live_stats->thread(thread))) {
+    all_counter[thread] = &stats->Callbacks;
+    this_event_counter = all_counter[thread];
+  } else if(archer_flags->print_ompt_counters && thread<MAX_THREADS) {
+    // Each thread allocates its own counters to get them on its NUMA node.
+    all_counter[thread] = new (allocLocal(sizeof(callback_counter_t))) callback_counter_t();
+    this_event_counter = all_counter[thread];
+  } else
+    this_event_counter=NULL;
+}
 
 static void
 ompt_tsan_thread_begin(
   ompt_thread_type_t thread_type,
   ompt_data_t *thread_data)
 {
-  pdp = new DataPool<ParallelData,4>;
+  thread_data->value = my_next_id();
+  current_region = active_regions.slot(thread_data->value);
+  // The pools are only used by this thread, so keep them on its NUMA node.
+  pdp = new (allocLocal(sizeof(DataPool<ParallelData,4>))) DataPool<ParallelData,4>(thread_data->value);
   TsanNewMemory(pdp, sizeof(pdp));
-  tgp = new DataPool<Taskgroup,4>;
+  tgp = new (allocLocal(sizeof(DataPool<Taskgroup,4>))) DataPool<Taskgroup,4>(thread_data->value);
   TsanNewMemory(tgp, sizeof(tgp));
-  tdp = new DataPool<TaskData,4>;
+  tdp = new (allocLocal(sizeof(DataPool<TaskData,4>))) DataPool<TaskData,4>(thread_data->value);
   TsanNewMemory(tdp, sizeof(tdp));
-  thread_data->value = my_next_id();
-  if(archer_flags->print_ompt_counters && thread_data->value<MAX_THREADS)
-    this_event_counter = &(all_counter[thread_data->value]);
-  else
-    this_event_counter=NULL;
+  pdrl = new RetireList<ParallelData,4>;
+  tgrl = new RetireList<Taskgroup,4>;
+  tdrl = new RetireList<TaskData,4>;
+  if (&__archer_offline_build)
+    archer_log_thread_begin(thread_data->value);
+  init_event_counter(thread_data->value);
   COUNT_EVENT1(thread_begin);
 }
 
@@ -474,8 +989,21 @@ ompt_tsan_parallel_begin(
   ompt_invoker_t invoker,
   const void *codeptr_ra)
 {
-  ParallelData* Data = new ParallelData;
+  ParallelData* Data = new ParallelData(codeptr_ra);
   parallel_data->ptr = Data;
+  if (track_region && current_region)
+    current_region->store(codeptr_ra, std::memory_order_relaxed);
+  if (clean_regions) {
+    Data->Region = clean_regions->lookup(codeptr_ra);
+    Data->SkipChecks = Data->Region && Data->Region->Clean &&
+                       archer_flags->clean_regions == 1;
+  }
+  if (archer_thread_log) {
+    TaskData* Parent = ToTaskData(parent_task_data);
+    Data->LogId = next_log_id++;
+    Data->LogParent = Parent->LogId;
+    Data->LogParentEpoch = Parent->LogEpoch;
+  }
 
   TsanHappensBefore(Data->GetParallelPtr());
   COUNT_EVENT1(parallel_begin);
@@ -492,18 +1020,85 @@ ompt_tsan_parallel_end(
   TsanHappensAfter(Data->GetBarrierPtr(0));
   TsanHappensAfter(Data->GetBarrierPtr(1));
 
+  // Back in the region of the encountering task.
+  if (track_region && current_region)
+    current_region->store(ToTaskData(task_data)->Team->codeptr_ra,
+                          std::memory_order_relaxed);
+
   delete Data;
 
 #if (LLVM_VERSION >= 40)
   if(&__swordomp__get_omp_status) {
-    if(__swordomp__get_omp_status() == 0 && archer_flags->flush_shadow)
+    if(__swordomp__get_omp_status() == 0 && archer_flags->flush_shadow &&
+       flush_policy.shouldFlush()) {
       __tsan_flush_memory();
+      if (archer_flags->verbose)
+        std::cerr << "Archer: flushed the shadow memory" << std::endl;
+    }
   }
 #endif
 
   COUNT_EVENT1(parallel_end);
 }
 
+/// Implicit tasks of clean regions run with TSan ignoring their accesses and
+/// with the uninstrumented code selected. Regions nested into them are only
+/// partially checked on this thread.
+static void beginRegionChecks(TaskData *Data) {
+  ParallelData *Team = Data->Team;
+  if (Team->SkipChecks) {
+    Data->SkipChecks = true;
+    if (skip_checks++ == 0) {
+      TsanIgnoreReadsBegin();
+      TsanIgnoreWritesBegin();
+#if (LLVM_VERSION >= 40)
+      if (&__swordomp__add_omp_status)
+        __swordomp__add_omp_status(ARCHER_SKIP_STATUS);
+#endif
+    }
+  } else if (Team->Region) {
+    if (skip_checks)
+      Team->Region->Partial.store(true, std::memory_order_relaxed);
+    else
+      Team->Region->Checked.store(true, std::memory_order_relaxed);
+  }
+}
+
+static void endRegionChecks() {
+  if (--skip_checks == 0) {
+#if (LLVM_VERSION >= 40)
+    if (&__swordomp__add_omp_status)
+      __swordomp__add_omp_status(-ARCHER_SKIP_STATUS);
+#endif
+    TsanIgnoreWritesEnd();
+    TsanIgnoreReadsEnd();
+  }
+}
+
+/// Called by TSan for every report it prints. All regions active on the
+/// reporting thread are no longer clean, and the run records no new clean
+/// regions. TSan defines this hook weakly in the application, so it only
+/// reaches us if libarcher is linked statically.
+extern "C" void __tsan_on_report(const void *report) {
+  if (live_stats)
+    live_stats->report();
+  if (report_log)
+    report_log->report(const_cast<void *>(report));
+  if (!clean_regions)
+    return;
+  clean_regions->reported();
+  ompt_data_t *parallel_data;
+  int team_size;
+  for (int level = 0;
+       ompt_get_parallel_info(level, &parallel_data, &team_size) &&
+       parallel_data && parallel_data->ptr;
+       level++) {
+    CleanRegion *Region = ToParallelData(parallel_data)->Region;
+    if (Region)
+      Region->Reported.store(true, std::memory_order_relaxed);
+  }
+}
+
 static void
 ompt_tsan_implicit_task(
     ompt_scope_endpoint_t endpoint,
@@ -517,6 +1112,18 @@ ompt_tsan_implicit_task(
      case ompt_scope_begin:
         task_data->ptr = new TaskData(ToParallelData(parallel_data));
         TsanHappensAfter(ToParallelData(parallel_data)->GetParallelPtr());
+        implicit_task_depth++;
+        if (clean_regions)
+          beginRegionChecks(ToTaskData(task_data));
+        if (archer_thread_log) {
+          ParallelData* PData = ToParallelData(parallel_data);
+          TaskData* Data = ToTaskData(task_data);
+          Data->LogId = next_log_id++;
+          Data->LogPrev = current_log_task;
+          current_log_task = Data->LogId;
+          archer_thread_log->event(LOG_IMPLICIT_BEGIN, Data->LogId, PData->LogId,
+                                   thread_num, PData->LogParent, PData->LogParentEpoch);
+        }
         COUNT_EVENT2(implicit_task,scope_begin);
         break;
      case ompt_scope_end:
@@ -524,7 +1131,24 @@ ompt_tsan_implicit_task(
         assert(Data->freed == 0 && "Implicit task end should only be called once!");
         Data->freed=1;
         assert(Data->RefCount == 1 && "All tasks should have finished at the implicit barrier!");
+        if (Data->SkipChecks)
+          endRegionChecks();
+        if (archer_thread_log) {
+          archer_thread_log->event(LOG_IMPLICIT_END, Data->LogId);
+          current_log_task = Data->LogPrev;
+          if (current_log_task)
+            archer_thread_log->event(LOG_TASK_SWITCH, current_log_task);
+        }
         delete Data;
+        // This thread may go idle now, so don't hold back other threads' data.
+        reclaimRetiredData();
+        if (--implicit_task_depth == 0) {
+          if (archer_flags->pool_trim > 0)
+            trimPools();
+          // Write the reports queued by __tsan_on_report.
+          if (report_log && report_log->pending())
+            report_log->flush();
+        }
         COUNT_EVENT2(implicit_task,scope_end);
         break;
   }
@@ -555,6 +1179,7 @@ ompt_tsan_sync_region(
             // For the latter case we will re-enable tracking in task_switch.
             Data->InBarrier = true;
             TsanIgnoreWritesBegin();
+            reclaimRetiredData();
             COUNT_EVENT3(sync_region,scope_begin,barrier);
             break;
           }
@@ -564,6 +1189,8 @@ ompt_tsan_sync_region(
             break;
         case ompt_sync_region_taskgroup:
             Data->TaskGroup = new Taskgroup(Data->TaskGroup);
+            if (archer_thread_log)
+              archer_thread_log->event(LOG_TASKGROUP_BEGIN, Data->LogId);
             COUNT_EVENT3(sync_region,scope_begin,taskgroup);
             break;
       }
@@ -587,14 +1214,22 @@ ompt_tsan_sync_region(
             // We are however guaranteed that this current barrier is finished
             // by the time we exit the next one. So we can then reuse the first address.
             Data->BarrierIndex = (BarrierIndex + 1) % 2;
+            if (archer_thread_log)
+              archer_thread_log->event(LOG_BARRIER_END, Data->LogId, ++Data->LogEpoch);
             COUNT_EVENT3(sync_region,scope_end,barrier);
             break;
           }
         case ompt_sync_region_taskwait:
           {
             COUNT_EVENT3(sync_region,scope_end,taskwait);
-            if(Data->execution>1)
+            // All children completed before the taskwait, reset the count
+            // for the next one.
+            if (Data->ReleasedChildren > 0) {
               TsanHappensAfter(Data->GetTaskwaitPtr());
+              Data->ReleasedChildren = 0;
+            }
+            if (archer_thread_log)
+              archer_thread_log->event(LOG_TASKWAIT_END, Data->LogId);
             break;
           }
         case ompt_sync_region_taskgroup:
@@ -607,6 +1242,8 @@ ompt_tsan_sync_region(
             Taskgroup* Parent = Data->TaskGroup->Parent;
             delete Data->TaskGroup;
             Data->TaskGroup = Parent;
+            if (archer_thread_log)
+              archer_thread_log->event(LOG_TASKGROUP_END, Data->LogId);
             COUNT_EVENT3(sync_region,scope_end,taskgroup);
             break;
           }
@@ -635,26 +1272,41 @@ ompt_tsan_task_create(
     ompt_data_t* parallel_data;
     int team_size = 1;
     ompt_get_parallel_info(0, &parallel_data, &team_size);
-    ParallelData* PData = new ParallelData;
+    ParallelData* PData = new ParallelData(nullptr);
     parallel_data->ptr = PData;
 
     Data = new TaskData(PData);
     new_task_data->ptr = Data;
+    if (archer_thread_log) {
+      Data->LogId = next_log_id++;
+      current_log_task = Data->LogId;
+      archer_thread_log->event(LOG_TASK_CREATE, Data->LogId, 0, 0);
+      archer_thread_log->event(LOG_TASK_SWITCH, Data->LogId);
+    }
     COUNT_EVENT2(task_create,initial);
   } else if (type == 5 /*ompt_task_included*/) {
     Data = new TaskData(ToTaskData(parent_task_data));
     new_task_data->ptr = Data;
     Data->Included=true;
+    if (archer_thread_log) {
+      Data->LogId = next_log_id++;
+      archer_thread_log->event(LOG_TASK_CREATE, Data->LogId, ToTaskData(parent_task_data)->LogId, 1);
+    }
     COUNT_EVENT2(task_create,included);
   } else {
-    Data = new TaskData(ToTaskData(parent_task_data));
+    TaskData* Parent = ToTaskData(parent_task_data);
+    Data = new TaskData(Parent);
     new_task_data->ptr = Data;
+    if (archer_thread_log) {
+      Data->LogId = next_log_id++;
+      archer_thread_log->event(LOG_TASK_CREATE, Data->LogId, Parent->LogId, 0);
+    }
 
     // Use the newly created address. We cannot use a single address from the
     // parent because that would declare wrong relationships with other
     // sibling tasks that may be created before this task is started!
     TsanHappensBefore(Data->GetTaskPtr());
-    ToTaskData(parent_task_data)->execution++;
+    Parent->execution++;
     COUNT_EVENT2(task_create,explicit);
   }
 }
@@ -669,13 +1321,21 @@ ompt_tsan_task_schedule(
   TaskData* FromTask = ToTaskData(first_task_data);
   TaskData* ToTask = ToTaskData(second_task_data);
 
+  if (archer_thread_log) {
+    current_log_task = ToTask->LogId;
+    archer_thread_log->event(LOG_TASK_SWITCH, ToTask->LogId);
+  }
+
   if (ToTask->Included && prior_task_status != ompt_task_complete)
     return; // No further synchronization for begin included tasks
   if (FromTask->Included && prior_task_status == ompt_task_complete) {
+    FromTask->Completed = true;
     // Just delete the task:
     while (FromTask != nullptr && --FromTask->RefCount == 0) {
       TaskData* Parent = FromTask->Parent;
       if (FromTask->DependencyCount > 0) {
+        count_objects(OBJ_DEPENDENCES, -1, sizeof(ompt_task_dependence_t) *
+                      FromTask->DependencyCount);
         delete[] FromTask->Dependencies;
       }
       delete FromTask;
@@ -686,10 +1346,13 @@ ompt_tsan_task_schedule(
 
   // we will use new stack, assume growing down
   // TsanNewMemory((char*)&FromTask-1024, 1024);
+  int Thread = tdp->Owner;
   if (ToTask->execution==0) {
     ToTask->execution++;
-  // 1. Task will begin execution after it has been created.
-    TsanHappensAfter(ToTask->GetTaskPtr());
+  // 1. Task will begin execution after it has been created. If this thread
+  //    created it, the creation is ordered before already.
+    if (ToTask->CreatorThread != Thread)
+      TsanHappensAfter(ToTask->GetTaskPtr());
     if ( ompt_get_task_memory_info ) {
       if ( !ompt_get_task_memory_info( &(ToTask->PrivateData), &(ToTask->PrivateDataSize), 0) ) {
         ToTask->PrivateData=nullptr; ToTask->PrivateDataSize=0;
@@ -707,10 +1370,11 @@ ompt_tsan_task_schedule(
         TsanHappensAfter(ToInAddr(Dependency->variable_addr));
       }
     }
-  } else {
-  // 2. Task will resume after it has been switched away.
+  } else if (ToTask->Thread.load(std::memory_order_relaxed) != Thread) {
+  // 2. Task will resume (on another thread) after it has been switched away.
     TsanHappensAfter(ToTask->GetTaskPtr());
   }
+  ToTask->Thread.store(Thread, std::memory_order_relaxed);
 
   if (prior_task_status != ompt_task_complete) {
     ToTask->ImplicitTask = FromTask->ImplicitTask;
@@ -719,7 +1383,8 @@ ompt_tsan_task_schedule(
 
   // Task may be resumed at a later point in time.
   //TsanHappensBeforeUC(FromTask->GetTaskPtr());
-  TsanHappensBefore(FromTask->GetTaskPtr());
+  if (prior_task_status != ompt_task_complete)
+    TsanHappensBefore(FromTask->GetTaskPtr());
 
   if (FromTask->InBarrier) {
     // We want to ignore writes in the runtime code during barriers,
@@ -733,12 +1398,24 @@ ompt_tsan_task_schedule(
       TsanFreeMemory(FromTask->PrivateData, FromTask->PrivateDataSize);
     }
 
+    FromTask->Completed = true;
+
     // Task will finish before a barrier in the surrounding parallel region ...
+    // If the implicit task of this thread has not reached the barrier yet, its
+    // own barrier begin orders this task before the barrier.
     ParallelData* PData = FromTask->Team;
-    TsanHappensBefore(PData->GetBarrierPtr(FromTask->ImplicitTask->BarrierIndex));
-
-    // ... and before an eventual taskwait by the parent thread.
-    TsanHappensBefore(FromTask->Parent->GetTaskwaitPtr());
+    if (FromTask->ImplicitTask->InBarrier)
+      TsanHappensBefore(PData->GetBarrierPtr(FromTask->ImplicitTask->BarrierIndex));
+
+    // ... and before an eventual taskwait by the parent thread. The edge is
+    // not needed once the parent completed and cannot wait anymore. Which
+    // thread will execute the taskwait is not known here, untied parents may
+    // resume on any thread.
+    TaskData* Parent = FromTask->Parent;
+    if (!Parent->Completed) {
+      TsanHappensBefore(Parent->GetTaskwaitPtr());
+      Parent->ReleasedChildren++;
+    }
 
     if (FromTask->TaskGroup != nullptr) {
         // This task is part of a taskgroup, so it will finish before the
@@ -757,6 +1434,8 @@ ompt_tsan_task_schedule(
     while (FromTask != nullptr && --FromTask->RefCount == 0) {
         TaskData* Parent = FromTask->Parent;
         if (FromTask->DependencyCount > 0) {
+            count_objects(OBJ_DEPENDENCES, -1, sizeof(ompt_task_dependence_t) *
+                          FromTask->DependencyCount);
             delete[] FromTask->Dependencies;
         }
         delete FromTask;
@@ -780,8 +1459,14 @@ static void ompt_tsan_task_dependences(
     // Copy the data to use it in task_switch and task_end.
     TaskData* Data = ToTaskData(task_data);
     Data->Dependencies = new ompt_task_dependence_t[ndeps];
+    count_objects(OBJ_DEPENDENCES, 1, sizeof(ompt_task_dependence_t) * ndeps);
     std::memcpy(Data->Dependencies, deps, sizeof(ompt_task_dependence_t) * ndeps);
     Data->DependencyCount = ndeps;
+    if (archer_thread_log)
+      for (int i = 0; i < ndeps; i++)
+        archer_thread_log->event(LOG_TASK_DEPENDENCE, Data->LogId,
+                                 (uint64_t)deps[i].variable_addr,
+                                 (deps[i].dependence_flags & ompt_task_dependence_type_out) ? 1 : 0);
 
     // This callback is executed before this task is first started.
     TsanHappensBefore(Data->GetTaskPtr());
@@ -789,33 +1474,63 @@ static void ompt_tsan_task_dependences(
 }
 
 /// OMPT event callbacks for handling locking.
+
+static void count_mutex_acquired(ompt_mutex_kind_t kind) {
+  // COUNT_EVENT does nothing without counters.
+  switch(kind)
+  {
+    case ompt_mutex_lock:
+      COUNT_EVENT2(mutex_acquired, lock);
+      break;
+    case ompt_mutex_nest_lock:
+      COUNT_EVENT2(mutex_acquired, nest_lock);
+      break;
+    case ompt_mutex_critical:
+      COUNT_EVENT2(mutex_acquired, critical);
+      break;
+    case ompt_mutex_atomic:
+      COUNT_EVENT2(mutex_acquired, atomic);
+      break;
+    case ompt_mutex_ordered:
+      COUNT_EVENT2(mutex_acquired, ordered);
+      break;
+    default:
+      COUNT_EVENT2(mutex_acquired, default);
+      break;
+  }
+}
+
+static void count_mutex_released(ompt_mutex_kind_t kind) {
+  // COUNT_EVENT does nothing without counters.
+  switch(kind)
+  {
+    case ompt_mutex_lock:
+      COUNT_EVENT2(mutex_released, lock);
+      break;
+    case ompt_mutex_nest_lock:
+      COUNT_EVENT2(mutex_released, nest_lock);
+      break;
+    case ompt_mutex_critical:
+      COUNT_EVENT2(mutex_released, critical);
+      break;
+    case ompt_mutex_atomic:
+      COUNT_EVENT2(mutex_released, atomic);
+      break;
+    case ompt_mutex_ordered:
+      COUNT_EVENT2(mutex_released, ordered);
+      break;
+    default:
+      COUNT_EVENT2(mutex_released, default);
+      break;
+  }
+}
+
 static void ompt_tsan_mutex_acquired(
   ompt_mutex_kind_t kind,
   ompt_wait_id_t wait_id,
   const void *codeptr_ra)
 {
-  if(archer_flags->print_ompt_counters)
-    switch(kind)
-    {
-      case ompt_mutex_lock:
-        COUNT_EVENT2(mutex_acquired, lock);
-        break;
-      case ompt_mutex_nest_lock:
-        COUNT_EVENT2(mutex_acquired, nest_lock);
-        break;
-      case ompt_mutex_critical:
-        COUNT_EVENT2(mutex_acquired, critical);
-        break;
-      case ompt_mutex_atomic:
-        COUNT_EVENT2(mutex_acquired, atomic);
-        break;
-      case ompt_mutex_ordered:
-        COUNT_EVENT2(mutex_acquired, ordered);
-        break;
-      default:
-        COUNT_EVENT2(mutex_acquired, default);
-        break;
-    }
+  count_mutex_acquired(kind);
 
   // Acquire our own lock to make sure that
   // 1. the previous release has finished.
@@ -829,6 +1544,8 @@ static void ompt_tsan_mutex_acquired(
   }
 
   TsanHappensAfter(ToWaitPtr(wait_id));
+  if (archer_thread_log)
+    archer_thread_log->event(LOG_MUTEX_ACQUIRED, wait_id);
 }
 
 static void ompt_tsan_mutex_released(
@@ -836,29 +1553,10 @@ static void ompt_tsan_mutex_released(
   ompt_wait_id_t wait_id,
   const void *codeptr_ra)
 {
-  if(archer_flags->print_ompt_counters)
-    switch(kind)
-    {
-      case ompt_mutex_lock:
-        COUNT_EVENT2(mutex_released, lock);
-        break;
-      case ompt_mutex_nest_lock:
-        COUNT_EVENT2(mutex_released, nest_lock);
-        break;
-      case ompt_mutex_critical:
-        COUNT_EVENT2(mutex_released, critical);
-        break;
-      case ompt_mutex_atomic:
-        COUNT_EVENT2(mutex_released, atomic);
-        break;
-      case ompt_mutex_ordered:
-        COUNT_EVENT2(mutex_released, ordered);
-        break;
-      default:
-        COUNT_EVENT2(mutex_released, default);
-        break;
-    }
+  count_mutex_released(kind);
   TsanHappensBefore(ToWaitPtr(wait_id));
+  if (archer_thread_log)
+    archer_thread_log->event(LOG_MUTEX_RELEASED, wait_id);
 
   {
     LocksMutex.lock();
@@ -869,12 +1567,167 @@ static void ompt_tsan_mutex_released(
   }
 }
 
+/// OMPT event callbacks of mode=counting and mode=profiling. They don't
+/// track any synchronization, so TSan ignores all accesses of the threads.
+
+static void
+ompt_count_thread_begin(
+  ompt_thread_type_t thread_type,
+  ompt_data_t *thread_data)
+{
+  thread_data->value = my_next_id();
+  current_region = active_regions.slot(thread_data->value);
+  TsanIgnoreReadsBegin();
+  TsanIgnoreWritesBegin();
+  init_event_counter(thread_data->value);
+  COUNT_EVENT1(thread_begin);
+}
+
+static void
+ompt_count_parallel_begin(
+  ompt_data_t *parent_task_data,
+  const ompt_frame_t *parent_task_frame,
+  ompt_data_t* parallel_data,
+  uint32_t requested_team_size,
+  ompt_invoker_t invoker,
+  const void *codeptr_ra)
+{
+  // Remember the enclosing region to restore it at the end.
+  if (track_region && current_region)
+    parallel_data->ptr = const_cast<void*>(
+      current_region->exchange(codeptr_ra, std::memory_order_relaxed));
+  COUNT_EVENT1(parallel_begin);
+}
+
+static void
+ompt_count_parallel_end(
+  ompt_data_t *parallel_data,
+  ompt_data_t *task_data,
+  ompt_invoker_t invoker,
+  const void *codeptr_ra)
+{
+  if (track_region && current_region)
+    current_region->store(parallel_data->ptr, std::memory_order_relaxed);
+  COUNT_EVENT1(parallel_end);
+}
+
+static void
+ompt_count_implicit_task(
+    ompt_scope_endpoint_t endpoint,
+    ompt_data_t *parallel_data,
+    ompt_data_t *task_data,
+    unsigned int team_size,
+    unsigned int thread_num)
+{
+  if (endpoint == ompt_scope_begin) {
+    COUNT_EVENT2(implicit_task,scope_begin);
+  } else {
+    COUNT_EVENT2(implicit_task,scope_end);
+  }
+}
+
+static void
+ompt_count_sync_region(
+  ompt_sync_region_kind_t kind,
+  ompt_scope_endpoint_t endpoint,
+  ompt_data_t *parallel_data,
+  ompt_data_t *task_data,
+  const void *codeptr_ra)
+{
+  if (!this_event_counter)
+    return;
+  bool begin = endpoint == ompt_scope_begin;
+  switch(kind)
+  {
+    case ompt_sync_region_barrier:
+      if (begin) {
+        COUNT_EVENT3(sync_region,scope_begin,barrier);
+      } else {
+        COUNT_EVENT3(sync_region,scope_end,barrier);
+      }
+      break;
+    case ompt_sync_region_taskwait:
+      if (begin) {
+        COUNT_EVENT3(sync_region,scope_begin,taskwait);
+      } else {
+        COUNT_EVENT3(sync_region,scope_end,taskwait);
+      }
+      break;
+    case ompt_sync_region_taskgroup:
+      if (begin) {
+        COUNT_EVENT3(sync_region,scope_begin,taskgroup);
+      } else {
+        COUNT_EVENT3(sync_region,scope_end,taskgroup);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+static void
+ompt_count_task_create(
+    ompt_data_t *parent_task_data,
+    const ompt_frame_t *parent_frame,
+    ompt_data_t* new_task_data,
+    ompt_task_type_t type,
+    int has_dependences,
+    const void *codeptr_ra)
+{
+  if (type == ompt_task_initial) {
+    COUNT_EVENT2(task_create,initial);
+  } else if (type == 5 /*ompt_task_included*/) {
+    COUNT_EVENT2(task_create,included);
+  } else {
+    COUNT_EVENT2(task_create,explicit);
+  }
+}
+
+static void
+ompt_count_task_schedule(
+    ompt_data_t *first_task_data,
+    ompt_task_status_t prior_task_status,
+    ompt_data_t *second_task_data)
+{
+  COUNT_EVENT1(task_schedule);
+}
+
+static void ompt_count_task_dependences(
+  ompt_data_t* task_data,
+  const ompt_task_dependence_t *deps,
+  int ndeps)
+{
+  COUNT_EVENT1(task_dependences);
+}
+
+static void ompt_count_mutex_acquired(
+  ompt_mutex_kind_t kind,
+  ompt_wait_id_t wait_id,
+  const void *codeptr_ra)
+{
+  count_mutex_acquired(kind);
+}
+
+static void ompt_count_mutex_released(
+  ompt_mutex_kind_t kind,
+  ompt_wait_id_t wait_id,
+  const void *codeptr_ra)
+{
+  count_mutex_released(kind);
+}
+
 #define SET_CALLBACK_T(event, type) \
   ompt_callback_##type##_t tsan_##event = &ompt_tsan_##event; \
   ompt_set_callback(ompt_callback_##event, (ompt_callback_t) tsan_##event)
 
 #define SET_CALLBACK(event) SET_CALLBACK_T(event, event)
 
+#define SET_COUNT_CALLBACK_T(event, type) \
+  ompt_callback_##type##_t count_##event = &ompt_count_##event; \
+  ompt_set_callback(ompt_callback_##event, (ompt_callback_t) count_##event)
+
+#define SET_COUNT_CALLBACK(event) SET_COUNT_CALLBACK_T(event, event)
+
 
 static int ompt_tsan_initialize(
   ompt_function_lookup_t lookup,
@@ -883,9 +1736,84 @@ static int ompt_tsan_initialize(
 
   const char *options = getenv("ARCHER_OPTIONS");
   archer_flags = new ArcherFlags(options);
+  if(archer_flags->help)
+    archer_flags->printHelp(std::cerr);
+  if(archer_flags->verbose)
+    archer_flags->printValues(std::cerr);
+  bool full = archer_flags->mode == ARCHER_MODE_FULL;
+  if(archer_flags->mode == ARCHER_MODE_COUNTING)
+    archer_flags->print_ompt_counters = 1;
+
+#if ARCHER_HAVE_LIBNUMA
+  archer_numa_available = (numa_available() >= 0);
+#endif
 
-  if(archer_flags->print_ompt_counters)
-    all_counter = new callback_counter_t[MAX_THREADS];
+  if(archer_flags->print_ompt_counters || archer_flags->live_stats > 0)
+    all_counter = new callback_counter_t*[MAX_THREADS]();
+
+#if ARCHER_DIRECT_TSAN
+  void *release = dlsym(RTLD_DEFAULT, "__tsan_release");
+  void *acquire = dlsym(RTLD_DEFAULT, "__tsan_acquire");
+  if (release && acquire) {
+    tsan_release = (void (*)(void *))release;
+    tsan_acquire = (void (*)(void *))acquire;
+  } else if (archer_flags->verbose)
+    std::cerr << "Archer: __tsan_release and __tsan_acquire not found, "
+                 "using the annotations" << std::endl;
+#endif
+
+  if(&__archer_offline_build && full) {
+    std::string dirname = ArcherFlags::expandPid(archer_flags->log_dir);
+    if (!archer_log_init(dirname.c_str(), archer_flags->log_buffer_size)) {
+      std::cerr << "Archer: could not create log directory " << dirname << ", exiting..." << std::endl;
+      std::exit(1);
+    }
+  }
+
+  if(archer_flags->rss_sampling > 0) {
+    std::string filename = ArcherFlags::expandPid(archer_flags->rss_file);
+    rss_sampler = new RssSampler(filename.c_str(), archer_flags->rss_sampling, &active_regions);
+    if (!rss_sampler->isOpen()) {
+      std::cerr << "Archer: could not open " << filename << " for RSS sampling" << std::endl;
+      delete rss_sampler;
+      rss_sampler = nullptr;
+    }
+  }
+
+  bool reports_visible =
+    dlsym(RTLD_DEFAULT, "__tsan_on_report") == (void*) &__tsan_on_report;
+  if(archer_flags->live_stats > 0) {
+    live_stats = new LiveStats(archer_flags->live_stats, &active_regions,
+                               reports_visible && full);
+    if (!live_stats->isOpen()) {
+      std::cerr << "Archer: could not create " << live_stats->name()
+                << " for live statistics" << std::endl;
+      delete live_stats;
+      live_stats = nullptr;
+    } else if (archer_flags->verbose)
+      std::cerr << "Archer: live statistics in " << live_stats->name() << std::endl;
+  }
+  track_region = rss_sampler || live_stats;
+
+  if(!archer_flags->report_dir.empty() && full) {
+    report_log = new ReportLog(archer_flags->report_dir,
+                               archer_flags->report_symbolize);
+    if (!report_log->isOpen()) {
+      std::cerr << "Archer: could not create the report file in "
+                << archer_flags->report_dir << std::endl;
+      delete report_log;
+      report_log = nullptr;
+    } else if (!reports_visible)
+      std::cerr << "Archer: report_dir needs libarcher to be linked statically, "
+                   "TSan does not pass the reports to a shared library" << std::endl;
+    else if (archer_flags->verbose)
+      std::cerr << "Archer: race reports in " << report_log->name() << std::endl;
+  }
+
+  if(archer_flags->clean_regions && full) {
+    clean_regions = new CleanRegionDB(archer_flags->clean_regions_file.c_str());
+    clean_regions->load();
+  }
 
   ompt_set_callback_t ompt_set_callback = (ompt_set_callback_t) lookup("ompt_set_callback");
   if (ompt_set_callback == NULL) {
@@ -902,38 +1830,111 @@ static int ompt_tsan_initialize(
     exit(1);
   }
 
-  SET_CALLBACK(thread_begin);
-//  SET_CALLBACK(thread_end);
-  SET_CALLBACK(parallel_begin);
-  SET_CALLBACK(implicit_task);
-  SET_CALLBACK(sync_region);
-  SET_CALLBACK(parallel_end);
-
-  SET_CALLBACK(task_create);
-  SET_CALLBACK(task_schedule);
-  SET_CALLBACK(task_dependences);
-
-  SET_CALLBACK_T(mutex_acquired, mutex);
-  SET_CALLBACK_T(mutex_released, mutex);
+  // Every registered callback costs a dispatch on each event, so only
+  // register what the mode needs.
+  switch(archer_flags->mode) {
+  case ARCHER_MODE_FULL: {
+    SET_CALLBACK(thread_begin);
+//    SET_CALLBACK(thread_end);
+    SET_CALLBACK(parallel_begin);
+    SET_CALLBACK(implicit_task);
+    SET_CALLBACK(sync_region);
+    SET_CALLBACK(parallel_end);
+
+    SET_CALLBACK(task_create);
+    SET_CALLBACK(task_schedule);
+    SET_CALLBACK(task_dependences);
+
+    if(!archer_flags->ignore_mutexes) {
+      SET_CALLBACK_T(mutex_acquired, mutex);
+      SET_CALLBACK_T(mutex_released, mutex);
+    }
+    break;
+  }
+  case ARCHER_MODE_COUNTING: {
+    SET_COUNT_CALLBACK(thread_begin);
+    SET_COUNT_CALLBACK(parallel_begin);
+    SET_COUNT_CALLBACK(implicit_task);
+    SET_COUNT_CALLBACK(sync_region);
+    SET_COUNT_CALLBACK(parallel_end);
+
+    SET_COUNT_CALLBACK(task_create);
+    SET_COUNT_CALLBACK(task_schedule);
+    SET_COUNT_CALLBACK(task_dependences);
+
+    if(!archer_flags->ignore_mutexes) {
+      SET_COUNT_CALLBACK_T(mutex_acquired, mutex);
+      SET_COUNT_CALLBACK_T(mutex_released, mutex);
+    }
+    break;
+  }
+  case ARCHER_MODE_PROFILING: {
+    SET_COUNT_CALLBACK(thread_begin);
+    SET_COUNT_CALLBACK(parallel_begin);
+    SET_COUNT_CALLBACK(parallel_end);
+    break;
+  }
+  }
   return 1; // success
 }
 
 
 static void ompt_tsan_finalize(ompt_fns_t* fns)
 {
-  if(archer_flags->print_ompt_counters) {
+  if(rss_sampler) {
+    delete rss_sampler;
+    rss_sampler = nullptr;
+  }
+
+  if(&__archer_offline_build)
+    archer_log_finalize();
+
+  if(clean_regions) {
+    // Without the report hook a racy region would be recorded as clean.
+    if(dlsym(RTLD_DEFAULT, "__tsan_on_report") != (void*) &__tsan_on_report)
+      std::cerr << "Archer: race reports are not visible to libarcher (link archer_static), "
+                << archer_flags->clean_regions_file << " not updated" << std::endl;
+    else if(!clean_regions->save())
+      std::cerr << "Archer: could not write " << archer_flags->clean_regions_file << std::endl;
+    delete clean_regions;
+    clean_regions = nullptr;
+  }
+
+  // print_callbacks sums into the counters of thread 0, so stop publishing
+  // the statistics first.
+  if(live_stats)
+    live_stats->finish();
+
+  if(archer_flags->print_ompt_counters)
     print_callbacks(all_counter);
+  if(all_counter) {
+    // Counters in the segment of live_stats are not allocated.
+    for (int i = 0; i < MAX_THREADS && all_counter[i]; i++)
+      if(!live_stats || all_counter[i] != &live_stats->thread(i)->Callbacks)
+        freeLocal(all_counter[i], sizeof(callback_counter_t));
     delete[] all_counter;
   }
 
+  if(live_stats) {
+    delete live_stats;
+    live_stats = nullptr;
+  }
+
+  if(report_log) {
+    delete report_log;
+    report_log = nullptr;
+  }
+
   if(archer_flags->print_max_rss) {
     struct rusage end;
     getrusage(RUSAGE_SELF, &end);
     printf("MAX RSS[KBytes] during execution: %ld\n", end.ru_maxrss);
   }
 
-  if(archer_flags)
+  if(archer_flags) {
     delete archer_flags;
+    archer_flags = nullptr;
+  }
 }
 
 
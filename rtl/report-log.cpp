@@ -0,0 +1,381 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "report-log.h"
+#include "modules.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Inspection of a report in __tsan_on_report, provided by the TSan runtime.
+extern "C" {
+int __tsan_get_report_data(void *report, const char **description, int *count,
+                           int *stack_count, int *mop_count, int *loc_count,
+                           int *mutex_count, int *thread_count,
+                           int *unique_tid_count, void **sleep_trace,
+                           unsigned long trace_size) __attribute__((weak));
+int __tsan_get_report_mop(void *report, unsigned long idx, int *tid,
+                          void **addr, int *size, int *write, int *atomic,
+                          void **trace, unsigned long trace_size)
+    __attribute__((weak));
+int __tsan_get_report_loc(void *report, unsigned long idx, const char **type,
+                          void **addr, unsigned long *start,
+                          unsigned long *size, int *tid, int *fd,
+                          int *suppressable, void **trace,
+                          unsigned long trace_size) __attribute__((weak));
+void __sanitizer_symbolize_pc(void *pc, const char *fmt, char *out_buf,
+                              size_t out_buf_size) __attribute__((weak));
+}
+
+// Environment variables of common MPI launchers that hold the rank.
+static const char *const RankVariables[] = {
+  "OMPI_COMM_WORLD_RANK", "PMI_RANK", "PMIX_RANK", "MV2_COMM_WORLD_RANK",
+  "SLURM_PROCID", nullptr
+};
+
+int ReportLog::rank() {
+  for (int i = 0; RankVariables[i]; i++) {
+    const char *value = getenv(RankVariables[i]);
+    if (value && *value)
+      return atoi(value);
+  }
+  return -1;
+}
+
+ReportLog::ReportLog(const std::string &dir, bool symbolize)
+    : File(nullptr), Rank(rank()), Symbolize(symbolize), Queue(nullptr),
+      Head(0), Tail(0), Dropped(0) {
+  if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+    return;
+  Name = dir + "/archer.";
+  if (Rank >= 0)
+    Name += std::to_string(Rank) + ".";
+  Name += std::to_string(getpid()) + ".jsonl";
+  File = fopen(Name.c_str(), "a");
+  if (File)
+    Queue = new QueuedReport[ARCHER_REPORT_QUEUE]();
+}
+
+ReportLog::~ReportLog() {
+  if (File) {
+    flush();
+    fclose(File);
+  }
+  delete[] Queue;
+}
+
+/// Appends JSON to a string.
+struct JsonWriter {
+  std::string Out;
+
+  void raw(const char *s) { Out += s; }
+
+  void string(const char *s) {
+    Out += '"';
+    for (; *s; s++) {
+      unsigned char c = *s;
+      if (c == '"' || c == '\\') {
+        Out += '\\';
+        Out += c;
+      } else if (c < 0x20) {
+        char buf[8];
+        snprintf(buf, sizeof(buf), "\\u%04x", c);
+        Out += buf;
+      } else
+        Out += c;
+    }
+    Out += '"';
+  }
+
+  void key(const char *name) {
+    if (!Out.empty() && Out.back() != '{' && Out.back() != '[')
+      Out += ',';
+    string(name);
+    Out += ':';
+  }
+
+  void number(const char *name, long value) {
+    key(name);
+    Out += std::to_string(value);
+  }
+
+  void boolean(const char *name, bool value) {
+    key(name);
+    Out += value ? "true" : "false";
+  }
+};
+
+// FNV-1a, stable across processes and builds of libarcher.
+static uint64_t hash(uint64_t h, const char *data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    h ^= (unsigned char)data[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+static const uint64_t HashSeed = 0xcbf29ce484222325ULL;
+
+const std::string &ReportLog::pcName(void *pc) {
+  auto it = PcNames.find(pc);
+  if (it != PcNames.end())
+    return it->second;
+
+  char name[64];
+  LoadedModule module;
+  if (!findModule((uintptr_t)pc, module)) {
+    snprintf(name, sizeof(name), "0x%lx", (unsigned long)pc);
+    return PcNames[pc] = name;
+  }
+
+  auto mod = Modules.find(module.Base);
+  if (mod == Modules.end()) {
+    // First frame in this module, describe the module for the symbolizer.
+    std::string path = modulePath(module);
+    size_t slash = path.rfind('/');
+    std::string short_name =
+      slash == std::string::npos ? path : path.substr(slash + 1);
+    mod = Modules.emplace(module.Base, short_name).first;
+
+    JsonWriter json;
+    char base[32];
+    snprintf(base, sizeof(base), "0x%lx", (unsigned long)module.Base);
+    json.raw("{");
+    json.key("module");
+    json.string(short_name.c_str());
+    json.key("path");
+    json.string(path.c_str());
+    json.key("base");
+    json.string(base);
+    json.key("build_id");
+    json.string(readBuildId(module).c_str());
+    json.raw("}\n");
+    PendingModules += json.Out;
+  }
+
+  snprintf(name, sizeof(name), "+0x%lx", (unsigned long)((uintptr_t)pc - module.Base));
+  return PcNames[pc] = mod->second + name;
+}
+
+uint64_t ReportLog::writeFrames(JsonWriter &json, void *const *trace) {
+  uint64_t h = HashSeed;
+  json.key("frames");
+  json.raw("[");
+  for (int i = 0; i < ARCHER_REPORT_FRAMES && trace[i]; i++) {
+    const std::string &pc = pcName(trace[i]);
+    h = hash(h, pc.c_str(), pc.size() + 1);
+
+    json.raw(i ? ",{" : "{");
+    json.key("pc");
+    json.string(pc.c_str());
+    if (Symbolize && __sanitizer_symbolize_pc) {
+      char symbol[1024];
+      symbol[0] = '\0';
+      __sanitizer_symbolize_pc(trace[i], "%f", symbol, sizeof(symbol));
+      if (symbol[0]) {
+        json.key("function");
+        json.string(symbol);
+      }
+      symbol[0] = '\0';
+      __sanitizer_symbolize_pc(trace[i], "%S", symbol, sizeof(symbol));
+      if (symbol[0]) {
+        json.key("source");
+        json.string(symbol);
+      }
+    }
+    json.raw("}");
+  }
+  json.raw("]");
+  return h;
+}
+
+// Copies a string of the TSan runtime, which may be null.
+static void copyString(char *dst, size_t size, const char *src) {
+  dst[0] = '\0';
+  if (src) {
+    strncpy(dst, src, size - 1);
+    dst[size - 1] = '\0';
+  }
+}
+
+void ReportLog::report(void *report) {
+  if (!Queue || !__tsan_get_report_data || !__tsan_get_report_mop)
+    return;
+
+  // Take a slot, only flush() frees them.
+  uint64_t head = Head.load(std::memory_order_relaxed);
+  do {
+    if (head - Tail.load(std::memory_order_acquire) >= ARCHER_REPORT_QUEUE) {
+      Dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  } while (!Head.compare_exchange_weak(head, head + 1,
+                                       std::memory_order_relaxed));
+  QueuedReport &queued = Queue[head % ARCHER_REPORT_QUEUE];
+
+  const char *description = nullptr;
+  int count, stack_count, mop_count, loc_count, mutex_count, thread_count,
+      unique_tid_count;
+  void *sleep_trace[1];
+  queued.Accesses = -1;
+  if (__tsan_get_report_data(report, &description, &count, &stack_count,
+                             &mop_count, &loc_count, &mutex_count,
+                             &thread_count, &unique_tid_count, sleep_trace,
+                             1)) {
+    copyString(queued.Type, sizeof(queued.Type), description);
+
+    void *loc_trace[1];
+    const char *loc_type = nullptr;
+    void *loc_addr;
+    unsigned long loc_start, loc_size;
+    int loc_tid, loc_fd, loc_suppressable;
+    queued.Location[0] = '\0';
+    if (loc_count > 0 && __tsan_get_report_loc &&
+        __tsan_get_report_loc(report, 0, &loc_type, &loc_addr, &loc_start,
+                              &loc_size, &loc_tid, &loc_fd, &loc_suppressable,
+                              loc_trace, 1))
+      copyString(queued.Location, sizeof(queued.Location), loc_type);
+
+    queued.Accesses = 0;
+    for (int i = 0; i < mop_count && queued.Accesses < ARCHER_REPORT_ACCESSES;
+         i++) {
+      auto &access = queued.Access[queued.Accesses];
+      void *addr;
+      memset(access.Trace, 0, sizeof(access.Trace));
+      if (__tsan_get_report_mop(report, i, &access.Tid, &addr, &access.Size,
+                                &access.Write, &access.Atomic, access.Trace,
+                                ARCHER_REPORT_FRAMES))
+        queued.Accesses++;
+    }
+  }
+  queued.Ready.store(true, std::memory_order_release);
+}
+
+void ReportLog::flush() {
+  if (!Queue)
+    return;
+  std::lock_guard<std::mutex> lock(Mutex);
+  uint64_t tail = Tail.load(std::memory_order_relaxed);
+  uint64_t head = Head.load(std::memory_order_acquire);
+  for (; tail != head; tail++) {
+    QueuedReport &queued = Queue[tail % ARCHER_REPORT_QUEUE];
+    // The slot is taken but report() is still filling it in.
+    if (!queued.Ready.load(std::memory_order_acquire))
+      break;
+    if (queued.Accesses >= 0)
+      write(queued);
+    queued.Ready.store(false, std::memory_order_relaxed);
+    Tail.store(tail + 1, std::memory_order_release);
+  }
+  fflush(File);
+
+  uint64_t dropped = Dropped.exchange(0, std::memory_order_relaxed);
+  if (dropped)
+    fprintf(stderr, "Archer: %llu race reports were dropped, more than %d "
+                    "arrived before %s was written\n",
+            (unsigned long long)dropped, ARCHER_REPORT_QUEUE, Name.c_str());
+}
+
+void ReportLog::write(const QueuedReport &report) {
+  const char *description = report.Type;
+
+  JsonWriter json;
+  json.raw("{");
+  json.number("rank", Rank);
+  json.number("pid", getpid());
+  json.key("type");
+  json.string(description[0] ? description : "unknown");
+
+  if (report.Location[0]) {
+    json.key("location");
+    json.string(report.Location);
+  }
+
+  // The accesses are written into their own buffer because the key, which
+  // comes first, depends on their stacks.
+  JsonWriter accesses;
+  std::vector<uint64_t> hashes;
+  accesses.raw("[");
+  for (int i = 0; i < report.Accesses; i++) {
+    const auto &access = report.Access[i];
+    accesses.raw(hashes.empty() ? "{" : ",{");
+    accesses.number("thread", access.Tid);
+    accesses.boolean("write", access.Write);
+    accesses.boolean("atomic", access.Atomic);
+    accesses.number("size", access.Size);
+    hashes.push_back(writeFrames(accesses, access.Trace));
+    accesses.raw("}");
+  }
+  accesses.raw("]");
+
+  // The same race may be reported with the accesses in either order.
+  std::sort(hashes.begin(), hashes.end());
+  uint64_t key = hash(HashSeed, description, strlen(description));
+  for (uint64_t h : hashes)
+    key = hash(key, (const char *)&h, sizeof(h));
+  char keystr[17];
+  snprintf(keystr, sizeof(keystr), "%016llx", (unsigned long long)key);
+  json.key("key");
+  json.string(keystr);
+
+  json.key("accesses");
+  json.raw(accesses.Out.c_str());
+  json.raw("}\n");
+
+  // Modules are written before the first report that refers to them.
+  fputs(PendingModules.c_str(), File);
+  PendingModules.clear();
+  fputs(json.Out.c_str(), File);
+}
@@ -0,0 +1,172 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Race reports as JSON lines.
+//
+// With report_dir=<dir> libarcher appends every report TSan hands to
+// __tsan_on_report as one line of JSON to <dir>/archer.<rank>.<pid>.jsonl,
+// where rank is the MPI rank found in the environment of the launcher, or
+// to <dir>/archer.<pid>.jsonl without one. A line looks like:
+//
+//   {"rank":3,"pid":4711,"type":"data-race","key":"1f0c93a2b4d5e6f7",
+//    "location":"heap","accesses":[{"thread":1,"write":true,"atomic":false,
+//    "size":4,"frames":[{"pc":"a.out+0x1234","function":"main",
+//    "source":"race.c:12:5"}]},...]}
+//
+// The key hashes the type of the report and the stacks of both accesses as
+// module name and offset, so it is the same for the same race in every
+// process of a job. archer-merge deduplicates the files of all processes by
+// this key and prints a ranked summary. Offsets are relative to the load
+// bias of the module, so they are addresses in its ELF file. Files written
+// before the module lines existed used the start of the mapping instead, so
+// their keys differ for programs that are not position independent.
+//
+// Before the first report that refers to a module, a line describes it:
+//
+//   {"module":"a.out","path":"/home/me/a.out","base":"0x555555554000",
+//    "build_id":"8f2c..."}
+//
+// so that frames can be symbolized after the run. With report_symbolize=0
+// the process does not symbolize at all and archer-merge symbolizes only
+// the races it prints, see archer-merge.cpp.
+//
+// TSan calls __tsan_on_report with its internal locks held, so report()
+// only copies the code addresses of the report into a preallocated queue,
+// without allocating, locking or symbolizing. flush() writes the queued
+// reports later from an OMPT callback or at exit. Reports that find the
+// queue full are dropped and counted, and reports still queued when the
+// process dies in TSan (halt_on_error=1) are lost.
+
+#ifndef ARCHER_REPORT_LOG_H
+#define ARCHER_REPORT_LOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct JsonWriter;
+
+/// Maximal number of frames written per access.
+#define ARCHER_REPORT_FRAMES 64
+
+/// Maximal number of accesses written per report, a race has two.
+#define ARCHER_REPORT_ACCESSES 2
+
+/// Number of reports queued between two flushes.
+#define ARCHER_REPORT_QUEUE 256
+
+class ReportLog {
+public:
+  /// Creates dir if it does not exist and opens the file of this process.
+  /// Without symbolize, frames are only written as module and offset.
+  ReportLog(const std::string &dir, bool symbolize);
+  ~ReportLog();
+
+  bool isOpen() const { return File != nullptr; }
+  const std::string &name() const { return Name; }
+
+  /// Queue the report passed to __tsan_on_report.
+  void report(void *report);
+
+  /// Whether reports wait to be written.
+  bool pending() const {
+    return Tail.load(std::memory_order_relaxed) !=
+           Head.load(std::memory_order_relaxed);
+  }
+
+  /// Write the queued reports. Must not be called from the report hook.
+  void flush();
+
+  /// MPI rank of this process from the environment, -1 if there is none.
+  static int rank();
+
+private:
+  /// What report() copies out of a TSan report.
+  struct QueuedReport {
+    std::atomic<bool> Ready;
+    char Type[32];
+    char Location[32];
+    int Accesses;
+    struct {
+      int Tid, Size, Write, Atomic;
+      void *Trace[ARCHER_REPORT_FRAMES + 1];
+    } Access[ARCHER_REPORT_ACCESSES];
+  };
+
+  /// Module name and offset of a code address.
+  const std::string &pcName(void *pc);
+  /// Writes the frames of one stack and returns their hash.
+  uint64_t writeFrames(JsonWriter &json, void *const *trace);
+  /// Writes one queued report.
+  void write(const QueuedReport &report);
+
+  FILE *File;
+  std::string Name;
+  int Rank;
+  bool Symbolize;
+  /// Queue of ARCHER_REPORT_QUEUE reports. Head counts the slots taken by
+  /// report(), Tail the ones written by flush().
+  QueuedReport *Queue;
+  std::atomic<uint64_t> Head;
+  std::atomic<uint64_t> Tail;
+  std::atomic<uint64_t> Dropped;
+  /// Serializes flush().
+  std::mutex Mutex;
+  std::unordered_map<void *, std::string> PcNames;
+  /// Short name of every module by load address.
+  std::unordered_map<uintptr_t, std::string> Modules;
+  /// Lines of the modules first seen in the current report.
+  std::string PendingModules;
+};
+
+#endif // ARCHER_REPORT_LOG_H
@@ -0,0 +1,179 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "rss.h"
+
+#include <algorithm>
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <unistd.h>
+
+// Provided by the sanitizer allocator if the application runs under TSan.
+extern "C" {
+size_t __attribute__((weak)) __sanitizer_get_current_allocated_bytes();
+}
+
+size_t get_current_rss() {
+  static long page_kb = 0;
+  char buf[128];
+  unsigned long size, resident;
+  ssize_t n;
+
+  int fd = open("/proc/self/statm", O_RDONLY);
+  if (fd < 0)
+    return 0;
+  n = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if (n <= 0)
+    return 0;
+  buf[n] = '\0';
+
+  // statm reports sizes in pages: size resident shared text lib data dt
+  if (sscanf(buf, "%lu %lu", &size, &resident) != 2)
+    return 0;
+  if (!page_kb)
+    page_kb = sysconf(_SC_PAGESIZE) / 1024;
+  return resident * page_kb;
+}
+
+size_t get_current_heap() {
+  // TSan does not export its shadow and meta memory usage, but the heap
+  // size tells us which part of the RSS is application data.
+  if (&__sanitizer_get_current_allocated_bytes)
+    return __sanitizer_get_current_allocated_bytes() / 1024;
+  return 0;
+}
+
+std::string format_codeptr(const void *codeptr) {
+  Dl_info info;
+  char buf[32];
+  if (!codeptr)
+    return std::string();
+  if (dladdr(codeptr, &info) && info.dli_fname) {
+    snprintf(buf, sizeof(buf), "+0x%" PRIxPTR,
+             (uintptr_t)codeptr - (uintptr_t)info.dli_fbase);
+    return info.dli_fname + std::string(buf);
+  }
+  snprintf(buf, sizeof(buf), "%p", codeptr);
+  return buf;
+}
+
+std::string RegionTracker::format() const {
+  const void *seen[MAX_THREADS];
+  int num_seen = 0;
+  std::string result;
+  for (int i = 0; i < MAX_THREADS; i++) {
+    const void *codeptr = Regions[i].load(std::memory_order_relaxed);
+    if (!codeptr || std::find(seen, seen + num_seen, codeptr) != seen + num_seen)
+      continue;
+    seen[num_seen++] = codeptr;
+    if (!result.empty())
+      result += ';';
+    result += format_codeptr(codeptr);
+  }
+  return result;
+}
+
+RssSampler::RssSampler(const char *filename, int period_ms,
+                       const RegionTracker *regions)
+    : File(fopen(filename, "w")), Period(period_ms),
+      Start(std::chrono::steady_clock::now()), Regions(regions), Stop(false) {
+  if (!File)
+    return;
+  fprintf(File, "time_ms,rss_kb,heap_kb,region\n");
+  Thread = std::thread(&RssSampler::run, this);
+}
+
+RssSampler::~RssSampler() {
+  if (!File)
+    return;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Stop = true;
+  }
+  Cond.notify_one();
+  Thread.join();
+  fclose(File);
+}
+
+void RssSampler::run() {
+  std::unique_lock<std::mutex> Lock(Mutex);
+  while (!Stop) {
+    sample();
+    Cond.wait_for(Lock, Period, [this] { return Stop; });
+  }
+  // Record the state at the end of the execution as well.
+  sample();
+}
+
+// Field of a CSV row, quoted as in RFC 4180 if it contains a separator.
+static std::string csv_field(const std::string &field) {
+  if (field.find_first_of(",\"\n") == std::string::npos)
+    return field;
+  std::string quoted = "\"";
+  for (char c : field) {
+    if (c == '"')
+      quoted += '"';
+    quoted += c;
+  }
+  return quoted + '"';
+}
+
+void RssSampler::sample() {
+  long long time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::steady_clock::now() - Start).count();
+  fprintf(File, "%lld,%zu,", time_ms, get_current_rss());
+  if (size_t heap = get_current_heap())
+    fprintf(File, "%zu", heap);
+  fprintf(File, ",%s\n", csv_field(Regions->format()).c_str());
+  // Keep the file up to date so it can be watched during the run.
+  fflush(File);
+}
@@ -0,0 +1,121 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef ARCHER_RSS_H
+#define ARCHER_RSS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "counter.h"
+
+// Current resident set size of the process in KBytes, 0 if unavailable.
+// Reads /proc/self/statm, which is a lot cheaper than parsing
+// /proc/self/status or walking /proc/self/smaps.
+size_t get_current_rss();
+
+// Heap of the application in KBytes, 0 if not running under TSan.
+size_t get_current_heap();
+
+// Code pointer relative to its module, e.g. "/usr/bin/app+0x1a2b", so that
+// it can be resolved with addr2line, even for position independent
+// executables. Empty for nullptr.
+std::string format_codeptr(const void *codeptr);
+
+/// Code pointers of the innermost parallel region that every thread started
+/// and that has not ended yet. Each thread only writes its own slot, so
+/// nested and concurrent regions don't overwrite each other.
+class RegionTracker {
+public:
+  /// Slot of thread id, nullptr if there are more threads than slots.
+  std::atomic<const void *> *slot(uint64_t id) {
+    return id < MAX_THREADS ? &Regions[id] : nullptr;
+  }
+
+  /// The distinct regions of all threads, formatted with format_codeptr()
+  /// and separated by ';'. Empty if no region executes.
+  std::string format() const;
+
+private:
+  std::atomic<const void *> Regions[MAX_THREADS];
+};
+
+/// Background thread that periodically appends the memory usage of the
+/// process to a CSV file. Every sample is tagged with the code pointers of the
+/// parallel regions that are currently executing, quoted if a module path
+/// contains a comma or a quote.
+class RssSampler {
+public:
+  RssSampler(const char *filename, int period_ms,
+             const RegionTracker *regions);
+  ~RssSampler();
+
+  bool isOpen() const { return File != nullptr; }
+
+private:
+  void run();
+  void sample();
+
+  FILE *File;
+  std::chrono::milliseconds Period;
+  std::chrono::steady_clock::time_point Start;
+  const RegionTracker *Regions;
+
+  std::mutex Mutex;
+  std::condition_variable Cond;
+  bool Stop;
+  std::thread Thread;
+};
+
+#endif // ARCHER_RSS_H
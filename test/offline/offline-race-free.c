@@ -0,0 +1,100 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// RUN: %libarcher-offline-compile && rm -rf %t.log
+// RUN: env ARCHER_OPTIONS="log_dir=%t.log" %t
+// RUN: %archer-analyze %t.log | FileCheck %s
+// REQUIRES: offline
+#include <omp.h>
+#include <stdio.h>
+
+#define N 1000
+
+int main(int argc, char* argv[])
+{
+  int a[N], b[N];
+  int sum = 0;
+  int var = 0;
+
+  #pragma omp parallel num_threads(2) shared(a, b, sum, var)
+  {
+    #pragma omp for schedule(static)
+    for (int i = 0; i < N; i++)
+      a[i] = i;
+
+    // The implicit barrier of the loop orders the reads after the writes.
+    #pragma omp for schedule(static)
+    for (int i = 0; i < N; i++)
+      b[i] = a[N - 1 - i];
+
+    #pragma omp critical
+    var++;
+
+    #pragma omp barrier
+
+    #pragma omp master
+    {
+      for (int i = 0; i < N; i++)
+        sum += b[i];
+
+      #pragma omp task shared(var)
+      var++;
+
+      #pragma omp taskwait
+      var++;
+    }
+  }
+
+  int error = (var != 4 || sum != N * (N - 1) / 2);
+  fprintf(stderr, "DONE\n");
+  return error;
+}
+
+// CHECK-NOT: WARNING: Archer: data race
+// CHECK: archer-analyze: 0 data races found in {{[0-9]+}} thread logs
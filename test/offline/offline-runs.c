@@ -0,0 +1,102 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Loops over arrays are logged as compressed runs. Check that the analyzer
+// decodes them and tells adjacent and interleaved runs from overlapping ones.
+
+// RUN: %libarcher-offline-compile && rm -rf %t.log
+// RUN: env ARCHER_OPTIONS="log_dir=%t.log" %t > %t.out
+// RUN: %archer-analyze %t.log >> %t.out || true
+// RUN: FileCheck %s < %t.out
+// REQUIRES: offline
+#include <omp.h>
+#include <stdio.h>
+
+#define N 1000
+
+int adjacent[N], interleaved[2 * N], overlapping[N], backward[N];
+
+int main(int argc, char* argv[])
+{
+  #pragma omp parallel num_threads(2)
+  {
+    int t = omp_get_thread_num();
+
+    // Contiguous runs that touch but don't overlap.
+    for (int i = t * N / 2; i < (t + 1) * N / 2; i++)
+      adjacent[i] = t;
+
+    // Strided runs whose ranges overlap, but not their elements.
+    for (int i = 0; i < N; i++)
+      interleaved[2 * i + t] = t;
+
+    // Contiguous runs that share one element.
+    for (int i = t ? N / 2 - 1 : 0; i < (t ? N : N / 2); i++)
+      overlapping[i] = t;
+
+    // A run with a negative stride that shares one element.
+    if (t)
+      for (int i = N - 1; i >= N / 2 - 1; i--)
+        backward[i] = t;
+    else
+      for (int i = 0; i < N / 2; i++)
+        backward[i] = t;
+  }
+
+  printf("overlapping %p\n", (void*)&overlapping[N / 2 - 1]);
+  printf("backward %p\n", (void*)&backward[N / 2 - 1]);
+  return 0;
+}
+
+// CHECK: overlapping [[OVERLAPPING:0x[0-9a-f]+]]
+// CHECK: backward [[BACKWARD:0x[0-9a-f]+]]
+// CHECK-DAG: WARNING: Archer: data race at [[OVERLAPPING]]
+// CHECK-DAG: WARNING: Archer: data race at [[BACKWARD]]
+// CHECK-NOT: WARNING: Archer: data race
+// CHECK: archer-analyze: 2 data races found in {{[0-9]+}} thread logs
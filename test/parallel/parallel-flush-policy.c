@@ -0,0 +1,113 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Counts the shadow memory flushes that verbose=1 prints between the
+// outermost regions for every trigger of the flush policy.
+
+// RUN: %libarcher-static-compile
+// RUN: env ARCHER_OPTIONS="verbose=1 flush_shadow=1 flush_every=3" %suppression %t 2>&1 | FileCheck --check-prefix=EVERY %s
+// RUN: env ARCHER_OPTIONS="verbose=1 flush_shadow=1 flush_interval=1" %suppression %t 2>&1 | FileCheck --check-prefix=ALL %s
+// RUN: env ARCHER_OPTIONS="verbose=1 flush_shadow=1 flush_interval=100000" %suppression %t 2>&1 | FileCheck --check-prefix=NONE %s
+// RUN: env ARCHER_OPTIONS="verbose=1 flush_shadow=1 flush_max_rss=1" %suppression %t 2>&1 | FileCheck --check-prefix=ALL %s
+// RUN: env ARCHER_OPTIONS="verbose=1 flush_shadow=1 flush_max_rss=1000000" %suppression %t 2>&1 | FileCheck --check-prefix=NONE %s
+// RUN: env ARCHER_OPTIONS="verbose=1 flush_every=3" %suppression %t 2>&1 | FileCheck --check-prefix=NONE %s
+// REQUIRES: archer-static
+#include <omp.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define NUM_REGIONS 6
+
+int main(int argc, char* argv[])
+{
+  int var = 0, i;
+
+  for (i = 1; i <= NUM_REGIONS; i++) {
+    // Lets at least flush_interval=1 pass since the last flush.
+    usleep(10000);
+    #pragma omp parallel num_threads(2) shared(var)
+    {
+      #pragma omp atomic
+      var++;
+    }
+    fprintf(stderr, "region %d\n", i);
+  }
+
+  fprintf(stderr, "DONE\n");
+  return var != 2 * NUM_REGIONS;
+}
+
+// EVERY-NOT: Archer: flushed
+// EVERY: region 1
+// EVERY-NEXT: region 2
+// EVERY-NEXT: Archer: flushed the shadow memory
+// EVERY-NEXT: region 3
+// EVERY-NEXT: region 4
+// EVERY-NEXT: region 5
+// EVERY-NEXT: Archer: flushed the shadow memory
+// EVERY-NEXT: region 6
+// EVERY-NEXT: DONE
+
+// ALL-NOT: region 1
+// ALL: Archer: flushed the shadow memory
+// ALL-NEXT: region 1
+// ALL-NEXT: Archer: flushed the shadow memory
+// ALL-NEXT: region 2
+// ALL-NEXT: Archer: flushed the shadow memory
+// ALL-NEXT: region 3
+// ALL-NEXT: Archer: flushed the shadow memory
+// ALL-NEXT: region 4
+// ALL-NEXT: Archer: flushed the shadow memory
+// ALL-NEXT: region 5
+// ALL-NEXT: Archer: flushed the shadow memory
+// ALL-NEXT: region 6
+// ALL-NEXT: DONE
+
+// NONE-NOT: Archer: flushed
+// NONE: DONE
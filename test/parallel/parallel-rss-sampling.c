@@ -0,0 +1,86 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// The RSS samples taken while a region runs are tagged with its code
+// pointer. The second run starts the program from a path with a comma,
+// which is quoted in the region field.
+
+// RUN: %libarcher-compile && rm -rf %t.csv %t.dir,x && mkdir %t.dir,x && cp %t %t.dir,x/app
+// RUN: env ARCHER_OPTIONS="rss_sampling=10 rss_file=%t.csv" %libarcher-run | FileCheck --check-prefix=OUT %s
+// RUN: FileCheck %s < %t.csv
+// RUN: env ARCHER_OPTIONS="rss_sampling=10 rss_file=%t.csv" %suppression %t.dir,x/app | FileCheck --check-prefix=OUT %s
+// RUN: FileCheck --check-prefix=QUOTED %s < %t.csv
+// REQUIRES: ompt
+#include <omp.h>
+#include <stdio.h>
+#include <unistd.h>
+
+int main(int argc, char* argv[])
+{
+  int var = 0;
+
+  #pragma omp parallel num_threads(2) shared(var)
+  {
+    #pragma omp atomic
+    var++;
+    // Long enough for several samples.
+    usleep(200000);
+  }
+
+  printf("DONE\n");
+  return var != 2;
+}
+
+// OUT: DONE
+
+// CHECK: time_ms,rss_kb,heap_kb,region
+// CHECK: {{^[0-9]+,[1-9][0-9]*,[0-9]*,[^",]*}}rss-sampling.c.tmp+0x{{[0-9a-f]+$}}
+
+// QUOTED: time_ms,rss_kb,heap_kb,region
+// QUOTED: {{^[0-9]+,[1-9][0-9]*,[0-9]*,"[^"]*}}rss-sampling.c.tmp.dir,x/app+0x{{[0-9a-f]+"$}}
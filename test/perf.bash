@@ -0,0 +1,79 @@
+#!/usr/bin/env bash
+# This script is used to record the overhead of selected archer tests.
+# It is invoked from lit tests as:
+# %perf mybinary
+# which is then substituted by lit to:
+# $(dirname %s)/perf.bash results baseline threshold root %s mybinary
+# The script runs the target program once and appends its wall time in
+# seconds and its peak RSS in KBytes to the results file, keyed by the
+# path of the test relative to root. If the baseline file has an entry
+# for the test, the run fails when the time or the RSS exceed the
+# baseline by more than threshold percent. A baseline is just the
+# results file of an earlier run.
+# A "// PERF-ARGS: ..." line in the test passes these arguments to the
+# program, so that it runs long enough for the time to be compared.
+
+RESULTS=$1
+BASELINE=$2
+THRESHOLD=$3
+ROOT=$4
+NAME=${5#$ROOT/}
+ARGS=$(sed -n 's|^// PERF-ARGS: ||p' $5)
+shift 5
+
+# Times below this many seconds are too noisy to compare.
+MIN_TIME=0.2
+
+# TSan sleeps for a second at exit by default, which would hide the time
+# of short runs.
+export TSAN_OPTIONS="$TSAN_OPTIONS atexit_sleep_ms=0"
+
+TMP=$(mktemp)
+START=$(date +%s.%N)
+if [[ -x /usr/bin/time ]]; then
+	/usr/bin/time -f "%M" -o $TMP "$@" $ARGS
+	STATUS=$?
+	RSS=$(tail -n 1 $TMP)
+else
+	# Let libarcher print the peak RSS and keep it out of the output
+	# that is checked.
+	ARCHER_OPTIONS="$ARCHER_OPTIONS print_max_rss=1" "$@" $ARGS > $TMP
+	STATUS=$?
+	grep -v "^MAX RSS\[KBytes\] during execution: " $TMP
+	RSS=$(sed -n 's/^MAX RSS\[KBytes\] during execution: //p' $TMP)
+fi
+END=$(date +%s.%N)
+rm -f $TMP
+
+if [[ $STATUS != 0 ]]; then
+	exit $STATUS
+fi
+
+TIME=$(awk "BEGIN { printf \"%.3f\", $END - $START }")
+echo "$NAME $TIME ${RSS:-0}" >> $RESULTS
+
+if [[ ! -f $BASELINE ]]; then
+	exit 0
+fi
+BASE=$(awk -v name="$NAME" '$1 == name { line = $0 } END { print line }' $BASELINE)
+if [[ -z $BASE ]]; then
+	exit 0
+fi
+read -r _ BASE_TIME BASE_RSS <<< "$BASE"
+
+awk -v name="$NAME" -v t=$TIME -v bt=$BASE_TIME -v r=${RSS:-0} -v br=$BASE_RSS \
+    -v limit=$THRESHOLD -v min_time=$MIN_TIME '
+BEGIN {
+	failed = 0
+	if (bt >= min_time && t > bt * (1 + limit / 100)) {
+		printf "%s: time %.3fs exceeds the baseline %.3fs by more than %d%%\n", \
+			name, t, bt, limit > "/dev/stderr"
+		failed = 1
+	}
+	if (r > 0 && br > 0 && r > br * (1 + limit / 100)) {
+		printf "%s: max RSS %dKB exceeds the baseline %dKB by more than %d%%\n", \
+			name, r, br, limit > "/dev/stderr"
+		failed = 1
+	}
+	exit failed
+}'
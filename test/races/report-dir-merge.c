@@ -0,0 +1,93 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Two runs write their reports to the same report_dir, archer-merge counts
+// the race once. With report_symbolize=0 the files only hold module offsets
+// and archer-merge symbolizes them with llvm-symbolizer from the PATH, as
+// TSan does.
+
+// RUN: %libarcher-static-compile && rm -rf %t.dir %t.dir0
+// RUN: env ARCHER_OPTIONS="report_dir=%t.dir" %suppression %deflake %t > /dev/null
+// RUN: env ARCHER_OPTIONS="report_dir=%t.dir" %suppression %deflake %t > /dev/null
+// RUN: %archer-merge -c "" %t.dir > %t.out || true
+// RUN: FileCheck %s < %t.out
+// RUN: env ARCHER_OPTIONS="report_dir=%t.dir0 report_symbolize=0" %suppression %deflake %t > /dev/null
+// RUN: env ARCHER_OPTIONS="report_dir=%t.dir0 report_symbolize=0" %suppression %deflake %t > /dev/null
+// RUN: %archer-merge -c "" -s false %t.dir0 > %t.raw || true
+// RUN: FileCheck --check-prefix=RAW %s < %t.raw
+// RUN: %archer-merge -c "" %t.dir0 > %t.out0 || true
+// RUN: FileCheck %s < %t.out0
+// REQUIRES: archer-static
+#include <omp.h>
+#include <stdio.h>
+
+int main(int argc, char* argv[])
+{
+  int var = 0;
+
+  #pragma omp parallel num_threads(2) shared(var)
+  {
+    var = omp_get_thread_num() + 1;
+  }
+
+  fprintf(stderr, "DONE\n");
+  return var == 0;
+}
+
+// CHECK: archer-merge: 1 distinct races in {{[0-9]+}} reports of {{[0-9]+}} processes
+// CHECK: #1 data-race {{[0-9a-f]+}}: {{[0-9]+}} reports in 2 processes
+// CHECK-NEXT:   Write of size 4 by thread T{{[0-9]+}}:
+// CHECK-NEXT:     #0 .omp_outlined.
+// CHECK:   Previous write of size 4 by thread T{{[0-9]+}}:
+// CHECK-NEXT:     #0 .omp_outlined.
+
+// Without a symbolizer the frames stay module offsets.
+// RAW: #1 data-race {{[0-9a-f]+}}: {{[0-9]+}} reports in 2 processes
+// RAW-NEXT:   Write of size 4 by thread T{{[0-9]+}}:
+// RAW-NEXT:     #0 (report-dir-merge.c.tmp+0x{{[0-9a-f]+}})
@@ -0,0 +1,137 @@
+#!/usr/bin/env bash
+# This script checks how the overhead of archer grows with the number of
+# threads and the problem size. It is invoked as:
+# scaling.bash [-t threads] [-s sizes] [-r repetitions] [-c compiler]
+#              [-p compiler] [-x tolerance] [tests...]
+# Every test (by default the ones in races and task) is compiled with
+# archer and without any instrumentation, with scaling.h included to
+# follow OMP_NUM_THREADS and to repeat the test, and run for every
+# number of threads and size. For every run it prints one CSV line:
+# test,threads,size,plain_s,archer_s,overhead,max_rss_kb,reports
+# where reports is the fraction of the repetitions with a race report,
+# i.e. the detection rate of the tests in races and the false positive
+# rate of the others. Afterwards the overhead is flagged when it grows
+# superlinearly, i.e. when the archer time grows faster than the size,
+# or the overhead faster than the number of threads, by more than the
+# tolerance. The script fails if anything is flagged.
+
+DIR=$(cd $(dirname $0) && pwd)
+ARCHER_CC=${ARCHER_CC:-clang-archer}
+PLAIN_CC=${PLAIN_CC:-clang -fopenmp}
+threads=""
+sizes="1 10 100"
+repetitions=3
+tolerance=0.25
+
+# Runs below this many seconds are too noisy to compare.
+MIN_TIME=0.1
+
+usage() {
+  echo "usage: $0 [-t threads] [-s sizes] [-r repetitions] [-c archer compiler]"
+  echo "         [-p plain compiler] [-x tolerance] [tests...]"
+  exit 1
+}
+
+while getopts "t:s:r:c:p:x:h" opt; do
+  case $opt in
+    t) threads=$OPTARG ;;
+    s) sizes=$OPTARG ;;
+    r) repetitions=$OPTARG ;;
+    c) ARCHER_CC=$OPTARG ;;
+    p) PLAIN_CC=$OPTARG ;;
+    x) tolerance=$OPTARG ;;
+    *) usage ;;
+  esac
+done
+shift $((OPTIND - 1))
+
+# 1, 2, 4, ... up to the number of cores.
+if [[ -z $threads ]]; then
+  cores=$(nproc 2>/dev/null || echo 8)
+  for ((t = 1; t <= cores; t *= 2)); do
+    threads="$threads $t"
+  done
+fi
+
+tests=("$@")
+if [[ ${#tests[@]} == 0 ]]; then
+  tests=($DIR/races/*.c $DIR/task/*.c)
+fi
+
+TMP=$(mktemp -d)
+trap "rm -rf $TMP" EXIT
+
+# Prints the best wall time of the repetitions, the peak RSS of that
+# run and the fraction of the repetitions with a race report.
+measure() {
+  local best="" rss="" reports=0
+  for ((i = 0; i < repetitions; i++)); do
+    local start=$(date +%s.%N)
+    ARCHER_OPTIONS="$ARCHER_OPTIONS print_max_rss=1" "$@" > $TMP/out 2>&1
+    local end=$(date +%s.%N)
+    local time=$(awk "BEGIN { printf \"%.4f\", $end - $start }")
+    if grep -q "ThreadSanitizer: data race" $TMP/out; then
+      reports=$((reports + 1))
+    fi
+    if [[ -z $best ]] || awk "BEGIN { exit !($time < $best) }"; then
+      best=$time
+      rss=$(sed -n 's/^MAX RSS\[KBytes\] during execution: //p' $TMP/out)
+    fi
+  done
+  echo "$best ${rss:-0} $(awk "BEGIN { printf \"%.2f\", $reports / $repetitions }")"
+}
+
+echo "test,threads,size,plain_s,archer_s,overhead,max_rss_kb,reports" | tee $TMP/results
+for test in "${tests[@]}"; do
+  name=$(cd $(dirname $test) && pwd)/$(basename $test)
+  name=${name#$DIR/}
+  if ! $ARCHER_CC -O1 -include $DIR/scaling.h $test -o $TMP/archer > $TMP/log 2>&1 ||
+     ! $PLAIN_CC -O1 -g -include $DIR/scaling.h $test -o $TMP/plain >> $TMP/log 2>&1; then
+    echo "$name: compilation failed" >&2
+    cat $TMP/log >&2
+    continue
+  fi
+  for t in $threads; do
+    for s in $sizes; do
+      export OMP_NUM_THREADS=$t ARCHER_SCALING_SIZE=$s
+      read -r plain _ _ <<< "$(measure $TMP/plain)"
+      read -r archer rss reports <<< "$(measure $TMP/archer)"
+      overhead=$(awk "BEGIN { printf \"%.2f\", $archer / ($plain > 0 ? $plain : 1e-4) }")
+      echo "$name,$t,$s,$plain,$archer,$overhead,$rss,$reports" | tee -a $TMP/results
+    done
+  done
+done
+
+# The growth exponent between two runs is log(y2/y1) / log(x2/x1), which
+# is 1 for linear growth. Sizes are compared at the same number of
+# threads, numbers of threads at the same size.
+awk -F, -v tolerance=$tolerance -v min_time=$MIN_TIME '
+function growth(y1, y2, x1, x2) {
+  return log(y2 / y1) / log(x2 / x1)
+}
+NR > 1 {
+  key = $1 "," $2
+  if (key in size && $5 >= min_time && prev_time[key] > 0) {
+    g = growth(prev_time[key], $5, size[key], $3)
+    if (g > 1 + tolerance) {
+      printf "%s: archer time grows superlinearly with the size at %d threads (%d -> %d: %.2fs -> %.2fs)\n", \
+        $1, $2, size[key], $3, prev_time[key], $5
+      flagged = 1
+    }
+  }
+  size[key] = $3
+  prev_time[key] = $5
+
+  key = $1 "," $3
+  if (key in nthreads && $5 >= min_time && $2 > nthreads[key] && overhead[key] > 0) {
+    g = growth(overhead[key], $6, nthreads[key], $2)
+    if (g > 1 + tolerance) {
+      printf "%s: overhead grows superlinearly with the threads at size %d (%d -> %d: %.2fx -> %.2fx)\n", \
+        $1, $3, nthreads[key], $2, overhead[key], $6
+      flagged = 1
+    }
+  }
+  nthreads[key] = $2
+  overhead[key] = $6
+}
+END { exit flagged }' $TMP/results >&2
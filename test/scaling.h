@@ -0,0 +1,90 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Included before a test by scaling.bash to run it at other thread
+// counts and problem sizes without changing the test:
+//  - num_threads() clauses use the number of threads of OMP_NUM_THREADS,
+//  - the main() of the test is called ARCHER_SCALING_SIZE times,
+//  - sleep() sleeps ARCHER_SCALING_SLEEP microseconds (default 10000),
+//    as the tests only sleep to let other threads steal their tasks.
+
+#ifndef ARCHER_SCALING_H
+#define ARCHER_SCALING_H
+
+#include <omp.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static __attribute__((unused))
+unsigned int archer_scaling_sleep(unsigned int seconds)
+{
+  const char *env = getenv("ARCHER_SCALING_SLEEP");
+  usleep(env ? atoi(env) : 10000);
+  return 0;
+}
+
+int archer_scaling_main(int argc, char* argv[]);
+
+int main(int argc, char* argv[])
+{
+  const char *env = getenv("ARCHER_SCALING_SIZE");
+  int size = env ? atoi(env) : 1;
+  int error = 0;
+  int i;
+
+  for (i = 0; i < size; i++)
+    error |= archer_scaling_main(argc, argv);
+  return error;
+}
+
+#define main archer_scaling_main
+#define sleep archer_scaling_sleep
+#define num_threads(n) num_threads(omp_get_max_threads())
+
+#endif // ARCHER_SCALING_H
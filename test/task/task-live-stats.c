@@ -0,0 +1,114 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// The program runs archer-top on itself while its tasks are alive and
+// checks the callbacks, the objects and the region in the segment.
+
+// RUN: %libarcher-compile && env ARCHER_OPTIONS="live_stats=10" %libarcher-run %archer-top | FileCheck %s
+// REQUIRES: ompt
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define NUM_TASKS 200
+
+int main(int argc, char* argv[])
+{
+  int release = 0, var = 0;
+  omp_lock_t lock;
+  omp_init_lock(&lock);
+
+  #pragma omp parallel num_threads(2) shared(release, var)
+  {
+    omp_set_lock(&lock);
+    var++;
+    omp_unset_lock(&lock);
+
+    #pragma omp master
+    {
+      int i;
+      for (i = 0; i < NUM_TASKS; i++) {
+        #pragma omp task shared(release)
+        {
+          int done;
+          do {
+            #pragma omp atomic read
+            done = release;
+          } while (!done);
+        }
+      }
+
+      // Let the statistics be updated while all tasks are alive.
+      usleep(200000);
+      char command[4096];
+      snprintf(command, sizeof(command), "%s -b -n 1 %d", argv[1], getpid());
+      fflush(stdout);
+      if (system(command) != 0)
+        printf("archer-top failed\n");
+
+      #pragma omp atomic write
+      release = 1;
+    }
+  }
+
+  omp_destroy_lock(&lock);
+  printf("DONE\n");
+  return var != 2;
+}
+
+// CHECK: archer-top: pid {{[0-9]+}}, {{.*}}, 2 threads
+// CHECK: region {{.*}}task-live-stats.c.tmp+0x{{[0-9a-f]+}}
+// CHECK: parallel {{ +[1-9]}}
+// CHECK: task_create {{ +[1-9][0-9][0-9]+}}
+// CHECK: mutex_acquired {{ +[1-9]}}
+// CHECK: mutex_released {{ +[1-9]}}
+// CHECK: TaskData {{ +[1-9][0-9][0-9]+}}
+// CHECK-NOT: archer-top failed
+// CHECK: DONE
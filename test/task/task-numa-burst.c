@@ -0,0 +1,112 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// With libnuma, a burst of tasks must not map every pool block separately.
+// The first run uses heap blocks placed by first touch, the second maps
+// node-local blocks of 64 KB because the pools are trimmed.
+
+// RUN: %libarcher-compile-and-run | FileCheck %s
+// RUN: env ARCHER_OPTIONS="pool_trim=0.5" %libarcher-run | FileCheck %s
+// REQUIRES: libnuma
+#include <omp.h>
+#include <stdio.h>
+#include "../../rtl/archer.h"
+
+#define NUM_TASKS 20000
+
+static int count_mappings()
+{
+  FILE *maps = fopen("/proc/self/maps", "r");
+  int lines = 0, c;
+  if (!maps)
+    return 0;
+  while ((c = fgetc(maps)) != EOF)
+    lines += (c == '\n');
+  fclose(maps);
+  return lines;
+}
+
+int main(int argc, char* argv[])
+{
+  int var = 0;
+  int before = count_mappings();
+
+  #pragma omp parallel num_threads(4) shared(var)
+  {
+    #pragma omp master
+    {
+      int i;
+      for (i = 0; i < NUM_TASKS; i++) {
+        #pragma omp task shared(var)
+        {
+          #pragma omp atomic
+          var++;
+        }
+      }
+    }
+  }
+
+  int after = count_mappings();
+  struct archer_stats stats;
+  if (!archer_get_stats || archer_get_stats(&stats) != 0) {
+    printf("no stats\n");
+    return 1;
+  }
+
+  // The threads, their stacks and the runtime add a few mappings, the pool
+  // blocks must not add one per 4 KB.
+  printf("tasks: %d\n", var == NUM_TASKS);
+  printf("mappings: %d\n",
+         after - before <= 32 + (long)(stats.task_data.pooled_bytes / 4096 / 4));
+
+  return var != NUM_TASKS;
+}
+
+// CHECK: tasks: 1
+// CHECK: mappings: 1
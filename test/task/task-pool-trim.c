@@ -0,0 +1,98 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// RUN: %libarcher-compile && env ARCHER_OPTIONS="pool_trim=0.5" %libarcher-run | FileCheck %s
+// REQUIRES: ompt
+#include <omp.h>
+#include <stdio.h>
+#include "../../rtl/archer.h"
+
+#define DEPTH 2000
+
+// Undeferred tasks nest, so all of them are alive at the innermost one.
+void nest(int depth, int* var)
+{
+  if (depth == 0)
+    return;
+  #pragma omp task if(0) shared(var)
+  {
+    (*var)++;
+    nest(depth - 1, var);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int var = 0;
+
+  #pragma omp parallel num_threads(2) shared(var)
+  {
+    #pragma omp master
+    nest(DEPTH, &var);
+  }
+
+  struct archer_stats stats;
+  if (!archer_get_stats || archer_get_stats(&stats) != 0) {
+    printf("no stats\n");
+    return 1;
+  }
+
+  // The blocks of the tasks were released at the end of the region. Counts
+  // are published in batches of 64 per thread, so the peak may miss up to
+  // 63 of the DEPTH + 2 tasks the master held.
+  printf("peak: %d\n", stats.task_data.peak_count >= DEPTH - 64);
+  printf("trimmed: %d\n",
+         stats.task_data.pooled_count < stats.task_data.peak_count);
+
+  int error = (var != DEPTH);
+  return error;
+}
+
+// CHECK: peak: 1
+// CHECK: trimmed: 1
@@ -0,0 +1,106 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// RUN: %libarcher-compile-and-run | FileCheck %s
+// REQUIRES: ompt
+#include <omp.h>
+#include <stdio.h>
+#include "../../rtl/archer.h"
+
+#define NUM_TASKS 200
+
+int main(int argc, char* argv[])
+{
+  int var = 0;
+  omp_lock_t lock;
+  omp_init_lock(&lock);
+
+  #pragma omp parallel num_threads(2) shared(var)
+  {
+    #pragma omp master
+    {
+      int i;
+      for (i = 0; i < NUM_TASKS; i++) {
+        #pragma omp task shared(var) depend(inout: var)
+        {
+          var++;
+        }
+      }
+    }
+
+    omp_set_lock(&lock);
+    omp_unset_lock(&lock);
+  }
+
+  omp_destroy_lock(&lock);
+
+  struct archer_stats stats;
+  if (!archer_get_stats || archer_get_stats(&stats) != 0) {
+    printf("no stats\n");
+    return 1;
+  }
+
+  // The master publishes its count after every 64 tasks it creates, before
+  // the other thread can have freed as many, so tasks and dependences were
+  // alive at that point. The mutex of the lock is kept after its destroy.
+  printf("parallel: %d\n", stats.parallel_data.pooled_count > 0);
+  printf("tasks: %d %d\n", stats.task_data.pooled_count > 0,
+         stats.task_data.peak_count >= 1);
+  printf("dependences: %d %d\n", stats.dependences.peak_count >= 1,
+         stats.dependences.peak_bytes > 0);
+  printf("locks: %llu\n", (unsigned long long)stats.locks.count);
+
+  int error = (var != NUM_TASKS);
+  return error;
+}
+
+// CHECK: parallel: 1
+// CHECK: tasks: 1 1
+// CHECK: dependences: 1 1
+// CHECK: locks: 1{{$}}
@@ -0,0 +1,894 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// archer-analyze: offline race checker for logs written by applications that
+// were compiled with clang-archer --archer-offline.
+//
+// The logs of all threads are decoded in parallel. Each access is attributed
+// to a segment, i.e. a piece of a task between two synchronization events
+// with a fixed set of held locks. Segments are then grouped by the barrier
+// interval of the outermost parallel region they belong to. Segments of
+// different intervals are always ordered, so the intervals are checked
+// independently and in parallel. Within an interval, overlapping accesses
+// and runs of accesses are found with an interval tree.
+
+#include "archer-log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+
+namespace {
+
+/// A join point inside a task: descendants created in [Begin, End) are
+/// complete once the task reaches segment number End.
+struct Join {
+  uint64_t Begin;
+  uint64_t End;
+};
+
+struct Dependence {
+  uint64_t Addr;
+  bool Out;
+};
+
+/// Everything the analyzer knows about a task. The creation part is logged
+/// by the creating thread, the rest by the executing thread.
+struct TaskInfo {
+  uint64_t Parent;
+  uint64_t Region;
+  bool Created;
+  bool Implicit;
+  bool Included;
+  /// Segment number and barrier epoch of the parent when the task was created.
+  uint64_t CreateSeg;
+  uint64_t CreateEpoch;
+  std::vector<Dependence> Deps;
+  /// Taskwaits only join the direct children.
+  std::vector<uint64_t> Taskwaits;
+  /// Barriers and taskgroups join all descendants.
+  std::vector<Join> DeepJoins;
+
+  TaskInfo()
+      : Parent(0), Region(0), Created(false), Implicit(false), Included(false),
+        CreateSeg(0), CreateEpoch(0) {}
+};
+
+/// A single access or a run of Count accesses, Stride bytes apart.
+struct Access {
+  uint64_t Addr;
+  uint64_t Pc;
+  int64_t Stride;
+  uint64_t Count;
+  uint32_t Size;
+  bool Write;
+};
+
+struct Segment {
+  uint32_t Thread;
+  uint64_t Task;
+  uint64_t Seg;
+  uint64_t Epoch;
+  std::vector<uint64_t> Locks;
+  std::vector<Access> Accesses;
+};
+
+/// Per-task state while decoding the log of the executing thread.
+struct TaskState {
+  uint64_t Seg;
+  uint64_t Epoch;
+  std::vector<uint64_t> TaskgroupBegins;
+
+  TaskState() : Seg(0), Epoch(0) {}
+};
+
+struct ThreadLog {
+  std::string Name;
+  uint32_t Thread;
+  std::unordered_map<uint64_t, TaskInfo> Tasks;
+  /// Segment number of the encountering task when a region started.
+  std::unordered_map<uint64_t, uint64_t> Regions;
+  std::vector<Segment> Segments;
+  /// Tasks that this thread executed.
+  std::vector<uint64_t> Executed;
+  bool Ok;
+
+  ThreadLog() : Thread(0), Ok(false) {}
+};
+
+class LogReader {
+public:
+  LogReader(const std::vector<uint8_t> &Data, size_t Pos)
+      : Data(Data), Pos(Pos), Truncated(false) {}
+
+  bool done() const { return Pos >= Data.size() || Truncated; }
+  bool truncated() const { return Truncated; }
+
+  uint8_t byte() {
+    if (Pos >= Data.size()) {
+      Truncated = true;
+      return 0;
+    }
+    return Data[Pos++];
+  }
+
+  uint64_t varint() {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t b = byte();
+      v |= (uint64_t)(b & 0x7f) << shift;
+      if (!(b & 0x80))
+        return v;
+    }
+    Truncated = true;
+    return v;
+  }
+
+private:
+  const std::vector<uint8_t> &Data;
+  size_t Pos;
+  bool Truncated;
+};
+
+static bool read_file(const std::string &Name, std::vector<uint8_t> &Data) {
+  std::ifstream In(Name.c_str(), std::ios::binary);
+  if (!In)
+    return false;
+  In.seekg(0, std::ios::end);
+  Data.resize(In.tellg());
+  In.seekg(0, std::ios::beg);
+  In.read((char *)Data.data(), Data.size());
+  return (bool)In;
+}
+
+/// Decode the log of one thread and split its accesses into segments.
+static void decode_log(ThreadLog &Log) {
+  std::vector<uint8_t> Data;
+  if (!read_file(Log.Name, Data)) {
+    fprintf(stderr, "archer-analyze: could not read %s\n", Log.Name.c_str());
+    return;
+  }
+  ArcherLogHeader Header;
+  if (Data.size() < sizeof(Header)) {
+    fprintf(stderr, "archer-analyze: %s is too short\n", Log.Name.c_str());
+    return;
+  }
+  memcpy(&Header, Data.data(), sizeof(Header));
+  if (memcmp(Header.magic, ARCHER_LOG_MAGIC, sizeof(Header.magic)) ||
+      Header.version != ARCHER_LOG_VERSION) {
+    fprintf(stderr, "archer-analyze: %s is no Archer log of version %d\n",
+            Log.Name.c_str(), ARCHER_LOG_VERSION);
+    return;
+  }
+  Log.Thread = Header.thread;
+
+  std::unordered_map<uint64_t, TaskState> States;
+  std::vector<uint64_t> Locks;
+  uint64_t Current = 0;
+  uint64_t LastAddr = 0, LastPc = 0;
+  Segment *Seg = nullptr;
+
+  // Any event that changes the current task, its segment number or the
+  // held locks ends the current segment.
+  auto endSegment = [&]() { Seg = nullptr; };
+  auto nextSeg = [&](uint64_t Task) -> uint64_t {
+    endSegment();
+    return ++States[Task].Seg;
+  };
+
+  LogReader R(Data, sizeof(Header));
+  while (!R.done()) {
+    uint8_t Type = R.byte();
+    if (Type < LOG_TASK_CREATE || (Type & LOG_RUN_MASK) == LOG_RUN_READ) {
+      Access A;
+      LastAddr += archer_log_unzigzag(R.varint());
+      LastPc += archer_log_unzigzag(R.varint());
+      size_t Code = Type & LOG_SIZE_OTHER;
+      A.Addr = LastAddr;
+      A.Pc = LastPc;
+      A.Size = Code == LOG_SIZE_OTHER ? R.varint() : archer_log_code_size(Code);
+      A.Write = Type & LOG_ACCESS_WRITE;
+      A.Stride = 0;
+      A.Count = 1;
+      if ((Type & LOG_RUN_MASK) == LOG_RUN_READ) {
+        A.Stride = archer_log_unzigzag(R.varint());
+        A.Count = R.varint();
+      }
+      if (!Seg) {
+        TaskState &S = States[Current];
+        Log.Segments.push_back(Segment());
+        Seg = &Log.Segments.back();
+        Seg->Thread = Log.Thread;
+        Seg->Task = Current;
+        Seg->Seg = S.Seg;
+        Seg->Epoch = S.Epoch;
+        Seg->Locks = Locks;
+        std::sort(Seg->Locks.begin(), Seg->Locks.end());
+      }
+      Seg->Accesses.push_back(A);
+      continue;
+    }
+
+    switch (Type) {
+    case LOG_TASK_CREATE: {
+      uint64_t Id = R.varint();
+      uint64_t Parent = R.varint();
+      bool Included = R.varint();
+      TaskInfo &Info = Log.Tasks[Id];
+      Info.Created = true;
+      Info.Parent = Parent;
+      Info.Included = Included;
+      if (Parent) {
+        TaskState &S = States[Parent];
+        Info.CreateSeg = S.Seg;
+        Info.CreateEpoch = S.Epoch;
+        nextSeg(Parent);
+      }
+      break;
+    }
+    case LOG_TASK_SWITCH:
+      Current = R.varint();
+      endSegment();
+      break;
+    case LOG_IMPLICIT_BEGIN: {
+      uint64_t Id = R.varint();
+      uint64_t Region = R.varint();
+      uint64_t ThreadNum = R.varint();
+      uint64_t Encountering = R.varint();
+      uint64_t EncounteringEpoch = R.varint();
+      TaskInfo &Info = Log.Tasks[Id];
+      Info.Implicit = true;
+      Info.Parent = Encountering;
+      Info.Region = Region;
+      Info.CreateEpoch = EncounteringEpoch;
+      // The primary thread executes the encountering task, the region is
+      // joined before the encountering task continues.
+      if (ThreadNum == 0 && Encountering) {
+        Log.Regions[Region] = States[Encountering].Seg;
+        nextSeg(Encountering);
+      }
+      Current = Id;
+      endSegment();
+      break;
+    }
+    case LOG_IMPLICIT_END: {
+      uint64_t Id = R.varint();
+      // All descendants are complete at the implicit barrier.
+      uint64_t End = nextSeg(Id);
+      Log.Tasks[Id].DeepJoins.push_back(Join{0, End});
+      Current = 0;
+      break;
+    }
+    case LOG_BARRIER_END: {
+      uint64_t Id = R.varint();
+      uint64_t Epoch = R.varint();
+      uint64_t End = nextSeg(Id);
+      States[Id].Epoch = Epoch;
+      Log.Tasks[Id].DeepJoins.push_back(Join{0, End});
+      break;
+    }
+    case LOG_TASKWAIT_END: {
+      uint64_t Id = R.varint();
+      Log.Tasks[Id].Taskwaits.push_back(nextSeg(Id));
+      break;
+    }
+    case LOG_TASKGROUP_BEGIN: {
+      uint64_t Id = R.varint();
+      States[Id].TaskgroupBegins.push_back(nextSeg(Id));
+      break;
+    }
+    case LOG_TASKGROUP_END: {
+      uint64_t Id = R.varint();
+      TaskState &S = States[Id];
+      uint64_t Begin = 0;
+      if (!S.TaskgroupBegins.empty()) {
+        Begin = S.TaskgroupBegins.back();
+        S.TaskgroupBegins.pop_back();
+      }
+      Log.Tasks[Id].DeepJoins.push_back(Join{Begin, nextSeg(Id)});
+      break;
+    }
+    case LOG_MUTEX_ACQUIRED:
+      Locks.push_back(R.varint());
+      endSegment();
+      break;
+    case LOG_MUTEX_RELEASED: {
+      uint64_t Wait = R.varint();
+      auto It = std::find(Locks.begin(), Locks.end(), Wait);
+      if (It != Locks.end())
+        Locks.erase(It);
+      endSegment();
+      break;
+    }
+    case LOG_TASK_DEPENDENCE: {
+      uint64_t Id = R.varint();
+      Dependence D;
+      D.Addr = R.varint();
+      D.Out = R.varint();
+      Log.Tasks[Id].Deps.push_back(D);
+      break;
+    }
+    default:
+      fprintf(stderr, "archer-analyze: unknown record %#x in %s\n", Type,
+              Log.Name.c_str());
+      return;
+    }
+  }
+  if (R.truncated())
+    fprintf(stderr, "archer-analyze: %s is truncated\n", Log.Name.c_str());
+  for (auto &Entry : States)
+    if (Entry.first)
+      Log.Executed.push_back(Entry.first);
+  Log.Ok = true;
+}
+
+/// One step of the path from the initial task to a segment: the task and its
+/// segment number and barrier epoch at the next step (or the segment itself).
+struct PathElem {
+  uint64_t Task;
+  uint64_t Seg;
+  uint64_t Epoch;
+};
+
+typedef std::vector<PathElem> Path;
+
+class Analyzer {
+public:
+  Analyzer(const std::unordered_map<uint64_t, TaskInfo> &Tasks)
+      : Tasks(Tasks) {
+    for (auto &Entry : Tasks)
+      if (!Entry.second.Deps.empty())
+        DepChildren[Entry.second.Parent].push_back(Entry.first);
+  }
+
+  Path path(const Segment &S) const {
+    Path P;
+    PathElem E = {S.Task, S.Seg, S.Epoch};
+    P.push_back(E);
+    uint64_t Task = S.Task;
+    while (Task) {
+      const TaskInfo *Info = find(Task);
+      if (!Info || !Info->Parent)
+        break;
+      PathElem Up = {Info->Parent, Info->CreateSeg, Info->CreateEpoch};
+      P.push_back(Up);
+      Task = Info->Parent;
+    }
+    std::reverse(P.begin(), P.end());
+    return P;
+  }
+
+  /// Returns true if all accesses of the two segments are ordered.
+  bool ordered(const Path &A, const Path &B) const {
+    size_t J = 0;
+    if (A[0].Task != B[0].Task)
+      return false;
+    while (J + 1 < A.size() && J + 1 < B.size() &&
+           A[J + 1].Task == B[J + 1].Task)
+      J++;
+    bool AEnds = J + 1 == A.size(), BEnds = J + 1 == B.size();
+    // Same task: executed sequentially.
+    if (AEnds && BEnds)
+      return true;
+    uint64_t SegA = A[J].Seg, SegB = B[J].Seg;
+    if (AEnds)
+      return SegA <= SegB || finishedBefore(B, J, SegA, nullptr);
+    if (BEnds)
+      return SegB <= SegA || finishedBefore(A, J, SegB, nullptr);
+
+    const TaskInfo *CA = find(A[J + 1].Task), *CB = find(B[J + 1].Task);
+    if (CA && CB && CA->Implicit && CB->Implicit && CA->Region == CB->Region)
+      return A[J + 1].Epoch != B[J + 1].Epoch;
+    if (SegA < SegB || (SegA == SegB && A[J + 1].Task < B[J + 1].Task))
+      return finishedBefore(A, J, SegB, &B[J + 1]);
+    return finishedBefore(B, J, SegA, &A[J + 1]);
+  }
+
+private:
+  const TaskInfo *find(uint64_t Task) const {
+    auto It = Tasks.find(Task);
+    return It == Tasks.end() ? nullptr : &It->second;
+  }
+
+  static bool deepJoined(const TaskInfo &Info, uint64_t Created,
+                         uint64_t Seg) {
+    for (const Join &J : Info.DeepJoins)
+      if (J.Begin <= Created && Created < J.End && J.End <= Seg)
+        return true;
+    return false;
+  }
+
+  /// Returns true if the child created at segment Created of Info is
+  /// complete once Info reaches segment Seg.
+  static bool directJoined(const TaskInfo &Info, const TaskInfo &Child,
+                           uint64_t Created, uint64_t Seg) {
+    if (Child.Implicit || Child.Included)
+      return Created < Seg;
+    for (uint64_t W : Info.Taskwaits)
+      if (Created < W && W <= Seg)
+        return true;
+    return deepJoined(Info, Created, Seg);
+  }
+
+  /// Returns true if a task with dependences on the same storage as Before
+  /// and created after it can only start once Before is complete.
+  bool dependsOn(uint64_t Parent, uint64_t Before, uint64_t After) const {
+    std::vector<uint64_t> Work(1, Before);
+    std::set<uint64_t> Seen;
+    const TaskInfo *To = find(After);
+    auto Siblings = DepChildren.find(Parent);
+    if (!To || Siblings == DepChildren.end())
+      return false;
+    // Walk the dependence graph between siblings created before After.
+    while (!Work.empty()) {
+      uint64_t Task = Work.back();
+      Work.pop_back();
+      const TaskInfo *From = find(Task);
+      if (!From || !Seen.insert(Task).second)
+        continue;
+      if (conflict(*From, *To))
+        return true;
+      for (uint64_t Id : Siblings->second) {
+        const TaskInfo &Next = *find(Id);
+        if (Next.CreateSeg <= From->CreateSeg ||
+            Next.CreateSeg >= To->CreateSeg)
+          continue;
+        if (conflict(*From, Next))
+          Work.push_back(Id);
+      }
+    }
+    return false;
+  }
+
+  static bool conflict(const TaskInfo &A, const TaskInfo &B) {
+    for (const Dependence &DA : A.Deps)
+      for (const Dependence &DB : B.Deps)
+        if (DA.Addr == DB.Addr && (DA.Out || DB.Out))
+          return true;
+    return false;
+  }
+
+  /// Returns true if the descendant at the end of path P, which branches
+  /// off P[J].Task, is complete when P[J].Task reaches segment Seg. If
+  /// Sibling is given, it is the later created child on the other path.
+  bool finishedBefore(const Path &P, size_t J, uint64_t Seg,
+                      const PathElem *Sibling) const {
+    const TaskInfo *Info = find(P[J].Task);
+    const TaskInfo *Child = find(P[J + 1].Task);
+    if (!Info || !Child)
+      return false;
+    uint64_t Created = P[J].Seg;
+    if (deepJoined(*Info, Created, Seg))
+      return true;
+
+    // The deeper descendants must be complete before the child is.
+    for (size_t K = J + 1; K + 1 < P.size(); K++) {
+      const TaskInfo *Up = find(P[K].Task);
+      const TaskInfo *Down = find(P[K + 1].Task);
+      if (!Up || !Down || !directJoined(*Up, *Down, P[K].Seg, UINT64_MAX))
+        return false;
+    }
+    if (directJoined(*Info, *Child, Created, Seg))
+      return true;
+    return Sibling && !Child->Deps.empty() &&
+           dependsOn(P[J].Task, P[J + 1].Task, Sibling->Task);
+  }
+
+  const std::unordered_map<uint64_t, TaskInfo> &Tasks;
+  /// Children with dependences of each task.
+  std::unordered_map<uint64_t, std::vector<uint64_t>> DepChildren;
+};
+
+/// An access normalized to a positive stride. Runs whose elements touch or
+/// overlap are merged into one contiguous element.
+struct Interval {
+  uint64_t Lo, Hi;
+  uint64_t Stride, Count;
+  uint32_t Size;
+  size_t Seg;
+  const Access *Acc;
+};
+
+static Interval make_interval(const Access &A, size_t Seg) {
+  Interval I;
+  int64_t Stride = A.Count > 1 ? A.Stride : 0;
+  I.Lo = Stride < 0 ? A.Addr + Stride * (int64_t)(A.Count - 1) : A.Addr;
+  I.Stride = Stride < 0 ? -Stride : Stride;
+  I.Count = I.Stride ? A.Count : 1;
+  I.Size = A.Size;
+  I.Hi = I.Lo + I.Stride * (I.Count - 1) + I.Size;
+  if (I.Stride <= I.Size) {
+    I.Stride = 0;
+    I.Count = 1;
+    I.Size = I.Hi - I.Lo;
+  }
+  I.Seg = Seg;
+  I.Acc = &A;
+  return I;
+}
+
+/// Returns true if one element of X overlaps one element of Y and stores
+/// the first overlapping address in Addr.
+static bool overlap(const Interval &X, const Interval &Y, uint64_t &Addr) {
+  // Walk the elements of the run with fewer elements.
+  const Interval &Few = X.Count <= Y.Count ? X : Y;
+  const Interval &Many = X.Count <= Y.Count ? Y : X;
+  uint64_t Lo = std::max(X.Lo, Y.Lo), Hi = std::min(X.Hi, Y.Hi);
+  uint64_t First = 0;
+  if (Few.Stride && Lo > Few.Lo + Few.Size)
+    First = (Lo - Few.Lo - Few.Size) / Few.Stride;
+  for (uint64_t I = First; I < Few.Count; I++) {
+    uint64_t P = Few.Lo + I * Few.Stride;
+    if (P >= Hi)
+      break;
+    uint64_t E = P + Few.Size;
+    if (!Many.Stride) {
+      if (P < Many.Hi && E > Many.Lo) {
+        Addr = std::max(P, Many.Lo);
+        return true;
+      }
+      continue;
+    }
+    // Elements J of Many with Many.Lo + J * Stride in (P - Size, E).
+    uint64_t JLo = 0;
+    if (P >= Many.Lo + Many.Size)
+      JLo = (P - Many.Lo - Many.Size) / Many.Stride + 1;
+    if (JLo >= Many.Count)
+      continue;
+    uint64_t Q = Many.Lo + JLo * Many.Stride;
+    if (Q < E) {
+      Addr = std::max(P, Q);
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Static interval tree: the intervals are sorted by their lower bound and
+/// form an implicit balanced search tree, each node knows the maximum upper
+/// bound of its subtree.
+class IntervalTree {
+public:
+  IntervalTree(std::vector<Interval> &V) : Items(V), MaxHi(V.size()) {
+    std::sort(Items.begin(), Items.end(),
+              [](const Interval &A, const Interval &B) { return A.Lo < B.Lo; });
+    build(0, Items.size());
+  }
+
+  const std::vector<Interval> &items() const { return Items; }
+
+  /// Call F with the index of every interval overlapping [Lo, Hi).
+  template <typename Fn>
+  void overlaps(uint64_t Lo, uint64_t Hi, Fn F) const {
+    visit(0, Items.size(), Lo, Hi, F);
+  }
+
+private:
+  uint64_t build(size_t B, size_t E) {
+    if (B >= E)
+      return 0;
+    size_t M = B + (E - B) / 2;
+    MaxHi[M] = std::max(Items[M].Hi, std::max(build(B, M), build(M + 1, E)));
+    return MaxHi[M];
+  }
+
+  template <typename Fn>
+  void visit(size_t B, size_t E, uint64_t Lo, uint64_t Hi, Fn &F) const {
+    if (B >= E)
+      return;
+    size_t M = B + (E - B) / 2;
+    if (MaxHi[M] <= Lo)
+      return;
+    visit(B, M, Lo, Hi, F);
+    if (Items[M].Lo >= Hi)
+      return;
+    if (Items[M].Hi > Lo)
+      F(M);
+    visit(M + 1, E, Lo, Hi, F);
+  }
+
+  std::vector<Interval> &Items;
+  std::vector<uint64_t> MaxHi;
+};
+
+struct Race {
+  uint64_t Addr;
+  uint32_t ThreadA, ThreadB;
+  bool WriteA, WriteB;
+};
+
+typedef std::map<std::pair<uint64_t, uint64_t>, Race> RaceMap;
+
+/// Check all segments of one barrier interval against each other.
+static void check_unit(const Analyzer &A, const std::vector<Segment *> &Segs,
+                       RaceMap &Races, std::mutex &RacesMutex) {
+  std::vector<Path> Paths;
+  std::vector<Interval> Intervals;
+  for (size_t I = 0; I < Segs.size(); I++) {
+    Paths.push_back(A.path(*Segs[I]));
+    for (const Access &Acc : Segs[I]->Accesses)
+      Intervals.push_back(make_interval(Acc, I));
+  }
+  IntervalTree Tree(Intervals);
+
+  std::map<std::pair<size_t, size_t>, bool> Ordered;
+  RaceMap Local;
+  const std::vector<Interval> &Items = Tree.items();
+  for (size_t I = 0; I < Items.size(); I++) {
+    const Interval &X = Items[I];
+    Tree.overlaps(X.Lo, X.Hi, [&](size_t K) {
+      const Interval &Y = Items[K];
+      if (K <= I || X.Seg == Y.Seg || !(X.Acc->Write || Y.Acc->Write))
+        return;
+      std::pair<uint64_t, uint64_t> Pcs(std::min(X.Acc->Pc, Y.Acc->Pc),
+                                        std::max(X.Acc->Pc, Y.Acc->Pc));
+      if (Local.count(Pcs))
+        return;
+      const Segment &SX = *Segs[X.Seg], &SY = *Segs[Y.Seg];
+      std::vector<uint64_t> Common;
+      std::set_intersection(SX.Locks.begin(), SX.Locks.end(),
+                            SY.Locks.begin(), SY.Locks.end(),
+                            std::back_inserter(Common));
+      if (!Common.empty())
+        return;
+      std::pair<size_t, size_t> Key(std::min(X.Seg, Y.Seg),
+                                    std::max(X.Seg, Y.Seg));
+      auto It = Ordered.find(Key);
+      if (It == Ordered.end())
+        It = Ordered.insert(std::make_pair(
+            Key, A.ordered(Paths[X.Seg], Paths[Y.Seg]))).first;
+      uint64_t Addr;
+      if (It->second || !overlap(X, Y, Addr))
+        return;
+      const Interval &First = X.Acc->Pc <= Y.Acc->Pc ? X : Y;
+      const Interval &Second = X.Acc->Pc <= Y.Acc->Pc ? Y : X;
+      Race R = {Addr, Segs[First.Seg]->Thread, Segs[Second.Seg]->Thread,
+                First.Acc->Write, Second.Acc->Write};
+      Local[Pcs] = R;
+    });
+  }
+
+  std::lock_guard<std::mutex> Lock(RacesMutex);
+  Races.insert(Local.begin(), Local.end());
+}
+
+struct Module {
+  uint64_t Begin, End, Offset;
+  std::string Path;
+};
+
+static std::vector<Module> read_maps(const std::string &Name) {
+  std::vector<Module> Modules;
+  FILE *F = fopen(Name.c_str(), "r");
+  if (!F)
+    return Modules;
+  char Line[4096];
+  while (fgets(Line, sizeof(Line), F)) {
+    Module M;
+    char Perms[8];
+    int PathPos = 0;
+    if (sscanf(Line, "%" SCNx64 "-%" SCNx64 " %7s %" SCNx64 " %*s %*s %n",
+               &M.Begin, &M.End, Perms, &M.Offset, &PathPos) < 4)
+      continue;
+    if (!strchr(Perms, 'x'))
+      continue;
+    M.Path = PathPos ? Line + PathPos : "";
+    M.Path.erase(M.Path.find_last_not_of(" \n") + 1);
+    Modules.push_back(M);
+  }
+  fclose(F);
+  return Modules;
+}
+
+static void print_pc(const std::vector<Module> &Modules, uint64_t Pc) {
+  // Pc is the return address of the logging call.
+  for (const Module &M : Modules)
+    if (M.Begin <= Pc && Pc < M.End) {
+      printf("%s+0x%" PRIx64, M.Path.c_str(), Pc - 1 - M.Begin + M.Offset);
+      return;
+    }
+  printf("0x%" PRIx64, Pc - 1);
+}
+
+static void usage() {
+  fprintf(stderr, "usage: archer-analyze [-j threads] <archer_log_pid>\n");
+  exit(2);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  unsigned Jobs = std::thread::hardware_concurrency();
+  std::string Dir;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-j") && i + 1 < argc)
+      Jobs = atoi(argv[++i]);
+    else if (argv[i][0] == '-')
+      usage();
+    else
+      Dir = argv[i];
+  }
+  if (Dir.empty())
+    usage();
+  if (Jobs == 0)
+    Jobs = 1;
+
+  std::vector<ThreadLog> Logs;
+  DIR *D = opendir(Dir.c_str());
+  if (!D) {
+    fprintf(stderr, "archer-analyze: could not open %s\n", Dir.c_str());
+    return 2;
+  }
+  while (struct dirent *E = readdir(D)) {
+    std::string Name = E->d_name;
+    if (Name.size() > 4 && Name.compare(Name.size() - 4, 4, ".log") == 0) {
+      Logs.push_back(ThreadLog());
+      Logs.back().Name = Dir + "/" + Name;
+    }
+  }
+  closedir(D);
+
+  auto parallel_for = [Jobs](size_t N, std::function<void(size_t)> Body) {
+    std::atomic<size_t> Next(0);
+    std::vector<std::thread> Workers;
+    for (unsigned i = 0; i < std::min<size_t>(Jobs, N); i++)
+      Workers.push_back(std::thread([&]() {
+        for (size_t I; (I = Next++) < N;)
+          Body(I);
+      }));
+    for (std::thread &T : Workers)
+      T.join();
+  };
+
+  parallel_for(Logs.size(), [&](size_t I) { decode_log(Logs[I]); });
+
+  // Merge the task information, the creation of a task is logged by another
+  // thread than its execution.
+  std::unordered_map<uint64_t, TaskInfo> Tasks;
+  std::unordered_map<uint64_t, uint64_t> Regions;
+  std::unordered_map<uint64_t, uint32_t> Executors;
+  for (ThreadLog &Log : Logs) {
+    if (!Log.Ok)
+      return 2;
+    // Segments are numbered by the executing thread, which requires tied
+    // tasks.
+    for (uint64_t Task : Log.Executed) {
+      auto It = Executors.insert(std::make_pair(Task, Log.Thread)).first;
+      if (It->second != Log.Thread) {
+        fprintf(stderr,
+                "archer-analyze: task %" PRIu64 " ran on threads T%u and T%u, "
+                "untied tasks are not supported\n",
+                Task, It->second, Log.Thread);
+        return 2;
+      }
+    }
+    Regions.insert(Log.Regions.begin(), Log.Regions.end());
+    for (auto &Entry : Log.Tasks) {
+      TaskInfo &To = Tasks[Entry.first];
+      TaskInfo &From = Entry.second;
+      if (From.Created || From.Implicit) {
+        To.Parent = From.Parent;
+        To.Region = From.Region;
+        To.Created = From.Created;
+        To.Implicit = From.Implicit;
+        To.Included = From.Included;
+        To.CreateSeg = From.CreateSeg;
+        To.CreateEpoch = From.CreateEpoch;
+      }
+      To.Deps.insert(To.Deps.end(), From.Deps.begin(), From.Deps.end());
+      To.Taskwaits.insert(To.Taskwaits.end(), From.Taskwaits.begin(),
+                          From.Taskwaits.end());
+      To.DeepJoins.insert(To.DeepJoins.end(), From.DeepJoins.begin(),
+                          From.DeepJoins.end());
+    }
+  }
+  for (auto &Entry : Tasks) {
+    TaskInfo &Info = Entry.second;
+    if (!Info.Implicit)
+      continue;
+    auto It = Regions.find(Info.Region);
+    if (It != Regions.end())
+      Info.CreateSeg = It->second;
+  }
+
+  // Group the segments by the barrier interval of the outermost region.
+  Analyzer A(Tasks);
+  std::map<std::pair<uint64_t, uint64_t>, std::vector<Segment *>> Units;
+  for (ThreadLog &Log : Logs)
+    for (Segment &S : Log.Segments) {
+      Path P = A.path(S);
+      std::pair<uint64_t, uint64_t> Key(0, 0);
+      if (P.size() > 1) {
+        auto It = Tasks.find(P[1].Task);
+        if (It != Tasks.end() && It->second.Implicit)
+          Key = std::make_pair(It->second.Region, P[1].Epoch);
+        else
+          Key = std::make_pair(P[1].Task, 0);
+      }
+      Units[Key].push_back(&S);
+    }
+
+  std::vector<std::vector<Segment *> *> Work;
+  for (auto &Entry : Units)
+    Work.push_back(&Entry.second);
+  RaceMap Races;
+  std::mutex RacesMutex;
+  parallel_for(Work.size(),
+               [&](size_t I) { check_unit(A, *Work[I], Races, RacesMutex); });
+
+  std::vector<Module> Modules = read_maps(Dir + "/maps");
+  for (auto &Entry : Races) {
+    const Race &R = Entry.second;
+    printf("WARNING: Archer: data race at 0x%" PRIx64 "\n", R.Addr);
+    printf("  %s by thread T%u at ", R.WriteA ? "Write" : "Read", R.ThreadA);
+    print_pc(Modules, Entry.first.first);
+    printf("\n  %s by thread T%u at ", R.WriteB ? "Write" : "Read", R.ThreadB);
+    print_pc(Modules, Entry.first.second);
+    printf("\n");
+  }
+  printf("archer-analyze: %zu data race%s found in %zu thread logs\n",
+         Races.size(), Races.size() == 1 ? "" : "s", Logs.size());
+  return Races.empty() ? 0 : 1;
+}
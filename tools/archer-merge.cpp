@@ -0,0 +1,720 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// archer-merge: deduplicates the race reports of many processes, e.g. the
+// ranks of a hybrid MPI+OpenMP job, that were written with report_dir.
+//
+// Every process writes its own file of JSON lines (see report-log.h). The
+// files are parsed in parallel, reports with the same key are merged and the
+// races are printed ranked by the number of processes that reported them and
+// then by the number of reports.
+//
+// Frames that the process did not symbolize (report_symbolize=0) are
+// symbolized here, only for the races that are printed. Their module is
+// described in the same file with its path and build-id. An llvm-symbolizer
+// process answers the queries, and the results are kept in a cache file per
+// build-id, by default in ~/.cache/archer/symbols, so that later merges of
+// the same build, also on other machines, do not need the binaries.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+/// A parsed JSON value, only as much as the report files need.
+struct Json {
+  enum Kind { Null, Bool, Number, String, Array, Object } Type;
+  bool B;
+  double N;
+  std::string S;
+  std::vector<Json> Items;
+  std::vector<std::pair<std::string, Json>> Members;
+
+  Json() : Type(Null), B(false), N(0) {}
+
+  const Json &operator[](const char *Name) const {
+    static const Json None;
+    for (const auto &M : Members)
+      if (M.first == Name)
+        return M.second;
+    return None;
+  }
+
+  Json *find(const char *Name) {
+    for (auto &M : Members)
+      if (M.first == Name)
+        return &M.second;
+    return nullptr;
+  }
+
+  void set(const char *Name, const std::string &Value) {
+    Json *V = find(Name);
+    if (!V) {
+      Members.push_back(std::make_pair(std::string(Name), Json()));
+      V = &Members.back().second;
+    }
+    V->Type = String;
+    V->S = Value;
+  }
+
+  long integer(long Default = 0) const {
+    return Type == Number ? (long)N : Default;
+  }
+  const char *str() const { return Type == String ? S.c_str() : ""; }
+};
+
+/// Recursive descent parser of one line.
+class JsonParser {
+public:
+  JsonParser(const std::string &Text) : P(Text.c_str()) {}
+
+  bool parse(Json &V) {
+    if (!value(V))
+      return false;
+    space();
+    return *P == '\0';
+  }
+
+private:
+  const char *P;
+
+  void space() {
+    while (*P == ' ' || *P == '\t' || *P == '\r' || *P == '\n')
+      P++;
+  }
+
+  bool literal(const char *Word) {
+    size_t Len = strlen(Word);
+    if (strncmp(P, Word, Len))
+      return false;
+    P += Len;
+    return true;
+  }
+
+  bool string(std::string &S) {
+    if (*P++ != '"')
+      return false;
+    for (; *P != '"'; P++) {
+      if (*P == '\0')
+        return false;
+      if (*P != '\\') {
+        S += *P;
+        continue;
+      }
+      switch (*++P) {
+      case 'n': S += '\n'; break;
+      case 't': S += '\t'; break;
+      case 'r': S += '\r'; break;
+      case 'b': S += '\b'; break;
+      case 'f': S += '\f'; break;
+      case 'u': {
+        char Hex[5] = {0};
+        for (int i = 0; i < 4; i++)
+          if (!(Hex[i] = *++P))
+            return false;
+        unsigned long C = strtoul(Hex, nullptr, 16);
+        // Only control characters are escaped by the writer.
+        S += C < 0x80 ? (char)C : '?';
+        break;
+      }
+      case '\0':
+        return false;
+      default:
+        S += *P;
+      }
+    }
+    P++;
+    return true;
+  }
+
+  bool value(Json &V) {
+    space();
+    switch (*P) {
+    case '{':
+      V.Type = Json::Object;
+      P++;
+      space();
+      if (*P == '}') {
+        P++;
+        return true;
+      }
+      for (;;) {
+        V.Members.push_back(std::make_pair(std::string(), Json()));
+        space();
+        if (!string(V.Members.back().first))
+          return false;
+        space();
+        if (*P++ != ':' || !value(V.Members.back().second))
+          return false;
+        space();
+        if (*P == '}') {
+          P++;
+          return true;
+        }
+        if (*P++ != ',')
+          return false;
+      }
+    case '[':
+      V.Type = Json::Array;
+      P++;
+      space();
+      if (*P == ']') {
+        P++;
+        return true;
+      }
+      for (;;) {
+        V.Items.push_back(Json());
+        if (!value(V.Items.back()))
+          return false;
+        space();
+        if (*P == ']') {
+          P++;
+          return true;
+        }
+        if (*P++ != ',')
+          return false;
+      }
+    case '"':
+      V.Type = Json::String;
+      return string(V.S);
+    case 't':
+      V.Type = Json::Bool;
+      V.B = true;
+      return literal("true");
+    case 'f':
+      V.Type = Json::Bool;
+      return literal("false");
+    case 'n':
+      return literal("null");
+    default: {
+      char *End;
+      V.Type = Json::Number;
+      V.N = strtod(P, &End);
+      if (End == P)
+        return false;
+      P = End;
+      return true;
+    }
+    }
+  }
+};
+
+/// All reports with the same key.
+struct Race {
+  uint64_t Reports;
+  std::set<int> Ranks;
+  std::set<size_t> Processes;
+  /// The first report, printed as the example of the race, and the index of
+  /// the file it is from.
+  std::shared_ptr<Json> Example;
+  size_t ExampleFile;
+
+  Race() : Reports(0), ExampleFile(0) {}
+
+  void merge(const Race &Other) {
+    if (!Example) {
+      Example = Other.Example;
+      ExampleFile = Other.ExampleFile;
+    }
+    Reports += Other.Reports;
+    Ranks.insert(Other.Ranks.begin(), Other.Ranks.end());
+    Processes.insert(Other.Processes.begin(), Other.Processes.end());
+  }
+};
+
+typedef std::unordered_map<std::string, Race> RaceMap;
+
+struct Module {
+  std::string Path;
+  std::string BuildId;
+};
+
+struct ReportFile {
+  std::string Name;
+  RaceMap Races;
+  /// Modules of the process by the name used in the frames.
+  std::unordered_map<std::string, Module> Modules;
+  uint64_t Reports;
+  uint64_t Errors;
+
+  ReportFile() : Reports(0), Errors(0) {}
+};
+
+/// Reads the reports of one process, the file index identifies the process.
+static void read_file(ReportFile &File, size_t Index) {
+  std::ifstream In(File.Name);
+  if (!In) {
+    fprintf(stderr, "archer-merge: could not open %s\n", File.Name.c_str());
+    File.Errors++;
+    return;
+  }
+  std::string Line;
+  while (std::getline(In, Line)) {
+    if (Line.empty())
+      continue;
+    std::shared_ptr<Json> Report(new Json);
+    bool Parsed = JsonParser(Line).parse(*Report) &&
+                  Report->Type == Json::Object;
+    if (Parsed && (*Report)["module"].Type == Json::String) {
+      Module &M = File.Modules[(*Report)["module"].S];
+      M.Path = (*Report)["path"].str();
+      M.BuildId = (*Report)["build_id"].str();
+      continue;
+    }
+    if (!Parsed || (*Report)["key"].Type != Json::String) {
+      // The last line may be incomplete if the process was killed.
+      File.Errors++;
+      continue;
+    }
+    Race &R = File.Races[(*Report)["key"].S];
+    if (!R.Example) {
+      R.Example = Report;
+      R.ExampleFile = Index;
+    }
+    R.Reports++;
+    long Rank = (*Report)["rank"].integer(-1);
+    if (Rank >= 0)
+      R.Ranks.insert(Rank);
+    R.Processes.insert(Index);
+    File.Reports++;
+  }
+}
+
+typedef std::map<uint64_t, std::pair<std::string, std::string>> SymbolMap;
+
+/// Symbolizes module offsets with llvm-symbolizer and a cache per build-id.
+class Symbolizer {
+public:
+  Symbolizer(const std::string &Program, const std::string &CacheDir)
+      : Program(Program), CacheDir(CacheDir), Pid(-1), In(nullptr),
+        Out(nullptr), Failed(false) {}
+
+  /// Stops llvm-symbolizer and appends the new results to the cache.
+  ~Symbolizer() {
+    if (In)
+      fclose(In);
+    if (Out)
+      fclose(Out);
+    if (Pid > 0)
+      waitpid(Pid, nullptr, 0);
+    for (auto &Entry : NewEntries) {
+      if (CacheDir.empty() || !make_dirs(CacheDir))
+        break;
+      FILE *F = fopen((CacheDir + "/" + Entry.first).c_str(), "a");
+      if (!F)
+        continue;
+      fputs(Entry.second.c_str(), F);
+      fclose(F);
+    }
+  }
+
+  /// Function and source location of Offset in M, false if unknown.
+  bool symbolize(const Module &M, uint64_t Offset, std::string &Function,
+                 std::string &Source) {
+    SymbolMap *Symbols = nullptr;
+    if (!M.BuildId.empty()) {
+      Symbols = &Cache[M.BuildId];
+      if (Loaded.insert(M.BuildId).second)
+        load(M.BuildId, *Symbols);
+      auto It = Symbols->find(Offset);
+      if (It != Symbols->end()) {
+        Function = It->second.first;
+        Source = It->second.second;
+        return !Function.empty();
+      }
+    }
+
+    if (!query(M.Path, Offset, Function, Source))
+      return false;
+    if (Symbols) {
+      (*Symbols)[Offset] = std::make_pair(Function, Source);
+      char Hex[32];
+      snprintf(Hex, sizeof(Hex), "%llx\t", (unsigned long long)Offset);
+      NewEntries[M.BuildId] += Hex + Function + "\t" + Source + "\n";
+    }
+    return !Function.empty();
+  }
+
+private:
+  std::string Program;
+  std::string CacheDir;
+  pid_t Pid;
+  FILE *In;
+  FILE *Out;
+  bool Failed;
+  std::map<std::string, SymbolMap> Cache;
+  std::set<std::string> Loaded;
+  /// Lines to append to the cache file of every build-id.
+  std::map<std::string, std::string> NewEntries;
+
+  static bool make_dirs(const std::string &Dir) {
+    for (size_t Pos = 0; Pos != std::string::npos;) {
+      Pos = Dir.find('/', Pos + 1);
+      std::string Prefix = Dir.substr(0, Pos);
+      if (mkdir(Prefix.c_str(), 0755) != 0 && errno != EEXIST)
+        return false;
+    }
+    return true;
+  }
+
+  /// Cache files have lines of the hex offset, the function and the source
+  /// location, separated by tabs.
+  void load(const std::string &BuildId, SymbolMap &Symbols) {
+    if (CacheDir.empty())
+      return;
+    std::ifstream F(CacheDir + "/" + BuildId);
+    std::string Line;
+    while (std::getline(F, Line)) {
+      size_t Tab1 = Line.find('\t');
+      size_t Tab2 = Tab1 == std::string::npos ? Tab1 : Line.find('\t', Tab1 + 1);
+      if (Tab2 == std::string::npos)
+        continue;
+      Symbols[strtoull(Line.c_str(), nullptr, 16)] = std::make_pair(
+          Line.substr(Tab1 + 1, Tab2 - Tab1 - 1), Line.substr(Tab2 + 1));
+    }
+  }
+
+  bool start() {
+    // A symbolizer that exits early must fail the query, not kill us.
+    signal(SIGPIPE, SIG_IGN);
+    int ToChild[2], FromChild[2];
+    if (pipe(ToChild) != 0)
+      return false;
+    if (pipe(FromChild) != 0) {
+      close(ToChild[0]);
+      close(ToChild[1]);
+      return false;
+    }
+    Pid = fork();
+    if (Pid == 0) {
+      signal(SIGPIPE, SIG_DFL);
+      dup2(ToChild[0], 0);
+      dup2(FromChild[1], 1);
+      close(ToChild[0]);
+      close(ToChild[1]);
+      close(FromChild[0]);
+      close(FromChild[1]);
+      execlp(Program.c_str(), Program.c_str(), "--inlining=false",
+             (char *)nullptr);
+      _exit(127);
+    }
+    close(ToChild[0]);
+    close(FromChild[1]);
+    if (Pid < 0) {
+      close(ToChild[1]);
+      close(FromChild[0]);
+      return false;
+    }
+    In = fdopen(ToChild[1], "w");
+    Out = fdopen(FromChild[0], "r");
+    return In && Out;
+  }
+
+  bool read_line(std::string &Line) {
+    char Buf[4096];
+    if (!fgets(Buf, sizeof(Buf), Out))
+      return false;
+    Line = Buf;
+    if (!Line.empty() && Line.back() == '\n')
+      Line.pop_back();
+    return true;
+  }
+
+  /// llvm-symbolizer answers every query with the function, the source
+  /// location and an empty line.
+  bool query(const std::string &Path, uint64_t Offset, std::string &Function,
+             std::string &Source) {
+    if (Failed || Path.empty())
+      return false;
+    if (!In && !start()) {
+      fprintf(stderr, "archer-merge: could not run %s\n", Program.c_str());
+      Failed = true;
+      return false;
+    }
+    if (fprintf(In, "CODE \"%s\" 0x%llx\n", Path.c_str(),
+                (unsigned long long)Offset) < 0 ||
+        fflush(In) != 0) {
+      fprintf(stderr, "archer-merge: could not write to %s\n", Program.c_str());
+      Failed = true;
+      return false;
+    }
+    std::string Line;
+    if (!read_line(Function) || !read_line(Source)) {
+      fprintf(stderr, "archer-merge: %s did not answer\n", Program.c_str());
+      Failed = true;
+      return false;
+    }
+    while (read_line(Line) && !Line.empty())
+      ;
+    if (Function == "??")
+      Function.clear();
+    if (Source.compare(0, 2, "??") == 0)
+      Source.clear();
+    return true;
+  }
+};
+
+/// Fills in the function and source location of the frames of a report that
+/// the process did not symbolize.
+static void symbolize_report(Json &Report, const ReportFile &File,
+                             Symbolizer &Sym) {
+  Json *Accesses = Report.find("accesses");
+  if (!Accesses)
+    return;
+  for (Json &Access : Accesses->Items) {
+    Json *Frames = Access.find("frames");
+    if (!Frames)
+      continue;
+    for (Json &Frame : Frames->Items) {
+      if (Frame["function"].Type == Json::String)
+        continue;
+      std::string Pc = Frame["pc"].str();
+      size_t Plus = Pc.rfind('+');
+      if (Plus == std::string::npos)
+        continue;
+      auto M = File.Modules.find(Pc.substr(0, Plus));
+      if (M == File.Modules.end())
+        continue;
+      std::string Function, Source;
+      uint64_t Offset = strtoull(Pc.c_str() + Plus + 1, nullptr, 16);
+      if (!Sym.symbolize(M->second, Offset, Function, Source))
+        continue;
+      Frame.set("function", Function);
+      if (!Source.empty())
+        Frame.set("source", Source);
+    }
+  }
+}
+
+/// Comma separated list of ranks with consecutive ranks as ranges.
+static std::string format_ranks(const std::set<int> &Ranks) {
+  std::string Out;
+  for (auto It = Ranks.begin(); It != Ranks.end();) {
+    int First = *It, Last = *It;
+    for (++It; It != Ranks.end() && *It == Last + 1; ++It)
+      Last = *It;
+    if (!Out.empty())
+      Out += ",";
+    Out += std::to_string(First);
+    if (Last > First)
+      Out += "-" + std::to_string(Last);
+  }
+  return Out;
+}
+
+static void print_race(int Number, const std::string &Key, const Race &R,
+                       int MaxFrames) {
+  const Json &Report = *R.Example;
+  printf("#%d %s %s: %llu reports in %zu processes", Number,
+         Report["type"].str(), Key.c_str(), (unsigned long long)R.Reports,
+         R.Processes.size());
+  if (!R.Ranks.empty())
+    printf(", ranks %s", format_ranks(R.Ranks).c_str());
+  printf("\n");
+
+  const Json &Accesses = Report["accesses"];
+  for (size_t i = 0; i < Accesses.Items.size(); i++) {
+    const Json &Access = Accesses.Items[i];
+    const char *Kind = Access["write"].B ? "write" : "read";
+    printf("  %s%s%s of size %ld by thread T%ld:\n",
+           i ? "Previous " : "", Access["atomic"].B ? "atomic " : "",
+           i ? Kind : (Access["write"].B ? "Write" : "Read"),
+           Access["size"].integer(), Access["thread"].integer());
+    const Json &Frames = Access["frames"];
+    for (size_t f = 0; f < Frames.Items.size() && (int)f < MaxFrames; f++) {
+      const Json &Frame = Frames.Items[f];
+      printf("    #%zu", f);
+      if (*Frame["function"].str())
+        printf(" %s", Frame["function"].str());
+      if (*Frame["source"].str())
+        printf(" %s", Frame["source"].str());
+      printf(" (%s)\n", Frame["pc"].str());
+    }
+    if (Frames.Items.size() > (size_t)MaxFrames)
+      printf("    ...\n");
+  }
+  if (*Report["location"].str())
+    printf("  Location is %s.\n", Report["location"].str());
+  printf("\n");
+}
+
+static void add_path(const std::string &Path, std::vector<ReportFile> &Files) {
+  struct stat St;
+  if (stat(Path.c_str(), &St) == 0 && S_ISDIR(St.st_mode)) {
+    DIR *D = opendir(Path.c_str());
+    if (!D)
+      return;
+    std::vector<std::string> Names;
+    while (struct dirent *E = readdir(D)) {
+      std::string Name = E->d_name;
+      if (Name.size() > 6 && Name.compare(Name.size() - 6, 6, ".jsonl") == 0)
+        Names.push_back(Path + "/" + Name);
+    }
+    closedir(D);
+    std::sort(Names.begin(), Names.end());
+    for (const std::string &Name : Names) {
+      Files.push_back(ReportFile());
+      Files.back().Name = Name;
+    }
+  } else {
+    Files.push_back(ReportFile());
+    Files.back().Name = Path;
+  }
+}
+
+static void usage() {
+  fprintf(stderr, "usage: archer-merge [-j threads] [-n races] [-f frames] "
+                  "[-s symbolizer] [-c cache_dir] <report_dir or file>...\n");
+  exit(2);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  unsigned Jobs = std::thread::hardware_concurrency();
+  int MaxRaces = -1;
+  int MaxFrames = 8;
+  std::string Program = getenv("ARCHER_SYMBOLIZER") ? getenv("ARCHER_SYMBOLIZER")
+                                                    : "llvm-symbolizer";
+  std::string CacheDir;
+  if (getenv("XDG_CACHE_HOME"))
+    CacheDir = std::string(getenv("XDG_CACHE_HOME")) + "/archer/symbols";
+  else if (getenv("HOME"))
+    CacheDir = std::string(getenv("HOME")) + "/.cache/archer/symbols";
+  std::vector<ReportFile> Files;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-j") && i + 1 < argc)
+      Jobs = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+      MaxRaces = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-f") && i + 1 < argc)
+      MaxFrames = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+      Program = argv[++i];
+    else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+      CacheDir = argv[++i];
+    else if (argv[i][0] == '-')
+      usage();
+    else
+      add_path(argv[i], Files);
+  }
+  if (Files.empty())
+    usage();
+  if (Jobs == 0)
+    Jobs = 1;
+
+  std::atomic<size_t> Next(0);
+  std::vector<std::thread> Workers;
+  for (unsigned i = 0; i < std::min<size_t>(Jobs, Files.size()); i++)
+    Workers.push_back(std::thread([&]() {
+      for (size_t I; (I = Next++) < Files.size();)
+        read_file(Files[I], I);
+    }));
+  for (std::thread &T : Workers)
+    T.join();
+
+  RaceMap Races;
+  uint64_t Reports = 0, Errors = 0;
+  for (ReportFile &File : Files) {
+    for (auto &Entry : File.Races)
+      Races[Entry.first].merge(Entry.second);
+    Reports += File.Reports;
+    Errors += File.Errors;
+    File.Races.clear();
+  }
+
+  std::vector<std::pair<const std::string *, const Race *>> Ranked;
+  for (auto &Entry : Races)
+    Ranked.push_back(std::make_pair(&Entry.first, &Entry.second));
+  std::sort(Ranked.begin(), Ranked.end(),
+            [](const std::pair<const std::string *, const Race *> &A,
+               const std::pair<const std::string *, const Race *> &B) {
+              if (A.second->Processes.size() != B.second->Processes.size())
+                return A.second->Processes.size() > B.second->Processes.size();
+              if (A.second->Reports != B.second->Reports)
+                return A.second->Reports > B.second->Reports;
+              return *A.first < *B.first;
+            });
+
+  printf("archer-merge: %zu distinct races in %llu reports of %zu processes\n\n",
+         Races.size(), (unsigned long long)Reports, Files.size());
+  Symbolizer Sym(Program, CacheDir);
+  for (size_t i = 0; i < Ranked.size() && (MaxRaces < 0 || (int)i < MaxRaces);
+       i++) {
+    const Race &R = *Ranked[i].second;
+    symbolize_report(*R.Example, Files[R.ExampleFile], Sym);
+    print_race(i + 1, *Ranked[i].first, R, MaxFrames);
+  }
+  if (MaxRaces >= 0 && Ranked.size() > (size_t)MaxRaces)
+    printf("... %zu more races\n", Ranked.size() - MaxRaces);
+
+  if (Errors)
+    fprintf(stderr, "archer-merge: %llu lines could not be read\n",
+            (unsigned long long)Errors);
+  return Races.empty() ? 0 : 1;
+}
@@ -0,0 +1,317 @@
+/*
+Copyright (c) 2015-2017, Lawrence Livermore National Security, LLC.
+
+Produced at the Lawrence Livermore National Laboratory
+
+Written by Simone Atzeni (simone@cs.utah.edu), Joachim Protze
+(joachim.protze@tu-dresden.de), Jonas Hahnfeld
+(hahnfeld@itc.rwth-aachen.de), Ganesh Gopalakrishnan, Zvonimir
+Rakamaric, Dong H. Ahn, Gregory L. Lee, Ignacio Laguna, and Martin
+Schulz.
+
+LLNL-CODE-727057
+
+All rights reserved.
+
+This file is part of Archer. For details, see
+https://pruners.github.io/archer. Please also read
+https://github.com/PRUNERS/archer/blob/master/LICENSE.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+   Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the disclaimer below.
+
+   Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the disclaimer (as noted below)
+   in the documentation and/or other materials provided with the
+   distribution.
+
+   Neither the name of the LLNS/LLNL nor the names of its contributors
+   may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LAWRENCE
+LIVERMORE NATIONAL SECURITY, LLC, THE U.S. DEPARTMENT OF ENERGY OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// archer-top: shows the live statistics of processes that run with
+// ARCHER_OPTIONS=live_stats=<ms>, see live-stats.h.
+//
+// usage: archer-top [-d seconds] [-n iterations] [-b] [pid]
+//
+// Without a pid it attaches to the only Archer process of the user, or
+// lists them if there are several. -b prints the statistics one after the
+// other instead of refreshing the screen.
+
+#include "live-stats.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+/// OMPT callbacks that are shown, every one sums a range of counters.
+struct CallbackGroup {
+  const char *Name;
+  size_t First;
+  size_t Last;
+};
+
+#define GROUP(name, first, last)                                               \
+  { name, offsetof(callback_counter_t, first),                                 \
+    offsetof(callback_counter_t, last) }
+
+const CallbackGroup Groups[] = {
+  GROUP("thread", thread_begin, thread_end),
+  GROUP("parallel", parallel_begin, parallel_end),
+  GROUP("implicit_task", implicit_task_scope_begin, implicit_task_scope_end),
+  GROUP("task_create", task_create_initial, task_create_untied),
+  GROUP("task_schedule", task_schedule, task_schedule),
+  GROUP("task_dependences", task_dependences, task_dependence),
+  GROUP("sync_region", sync_region_scope_begin_barrier,
+        sync_region_scope_end_taskgroup),
+  GROUP("mutex_acquired", mutex_acquired_lock, mutex_acquired_default),
+  GROUP("mutex_released", mutex_released_lock, mutex_released_default),
+};
+
+const int NumGroups = sizeof(Groups) / sizeof(Groups[0]);
+
+/// Bookkeeping objects in the order of struct archer_stats.
+const char *ObjectNames[] = {"ParallelData", "TaskData", "Taskgroup",
+                             "dependences", "locks"};
+const int NumObjects = sizeof(ObjectNames) / sizeof(ObjectNames[0]);
+
+/// Sums over all threads of one look at the segment.
+struct Snapshot {
+  uint64_t Callbacks[NumGroups];
+  uint64_t Total;
+  int Threads;
+  std::chrono::steady_clock::time_point Time;
+};
+
+Snapshot takeSnapshot(const ArcherLiveStats *Stats) {
+  Snapshot S = Snapshot();
+  S.Time = std::chrono::steady_clock::now();
+  for (uint32_t t = 0; t < Stats->max_threads && t < MAX_THREADS; t++) {
+    const ArcherThreadStats &T = Stats->threads[t];
+    const char *Counters = (const char *)&T.Callbacks;
+    if (T.Callbacks.thread_begin == 0)
+      continue;
+    S.Threads++;
+    for (int g = 0; g < NumGroups; g++)
+      for (size_t o = Groups[g].First; o <= Groups[g].Last; o += sizeof(int))
+        S.Callbacks[g] += *(const int *)(Counters + o);
+    for (size_t o = 0; o < sizeof(callback_counter_t); o += sizeof(int))
+      S.Total += *(const int *)(Counters + o);
+  }
+  return S;
+}
+
+std::string formatKB(uint64_t kb) {
+  char buf[32];
+  if (kb >= 1024 * 1024)
+    snprintf(buf, sizeof(buf), "%.1f GB", kb / (1024.0 * 1024.0));
+  else if (kb >= 1024)
+    snprintf(buf, sizeof(buf), "%.1f MB", kb / 1024.0);
+  else
+    snprintf(buf, sizeof(buf), "%" PRIu64 " KB", kb);
+  return buf;
+}
+
+void print(const ArcherLiveStats *Stats, const Snapshot &Now,
+           const Snapshot *Prev) {
+  double Seconds = 0;
+  if (Prev)
+    Seconds = std::chrono::duration<double>(Now.Time - Prev->Time).count();
+
+  printf("archer-top: pid %u, %.1fs, %d threads%s\n", Stats->pid,
+         Stats->time_ms / 1000.0, Now.Threads,
+         Stats->finished ? " (finished)" : "");
+  printf("RSS %s (max %s)", formatKB(Stats->rss_kb).c_str(),
+         formatKB(Stats->max_rss_kb).c_str());
+  if (Stats->heap_kb)
+    printf(", heap %s", formatKB(Stats->heap_kb).c_str());
+  if (Stats->reports_visible)
+    printf(", %" PRIu64 " race reports\n", Stats->reports);
+  else
+    printf(", race reports not visible (link archer_static)\n");
+  printf("region %s\n\n", Stats->region[0] ? Stats->region : "-");
+
+  printf("%-20s %14s %14s\n", "callback", "total", "per second");
+  for (int g = 0; g < NumGroups; g++) {
+    if (!Now.Callbacks[g])
+      continue;
+    printf("%-20s %14" PRIu64, Groups[g].Name, Now.Callbacks[g]);
+    if (Seconds > 0)
+      printf(" %14.0f", (Now.Callbacks[g] - Prev->Callbacks[g]) / Seconds);
+    printf("\n");
+  }
+  printf("%-20s %14" PRIu64, "all", Now.Total);
+  if (Seconds > 0)
+    printf(" %14.0f", (Now.Total - Prev->Total) / Seconds);
+  printf("\n\n");
+
+  printf("%-20s %14s %14s %14s\n", "objects", "in use", "peak", "allocated");
+  const archer_object_stats *Objects[] = {
+      &Stats->objects.parallel_data, &Stats->objects.task_data,
+      &Stats->objects.taskgroup, &Stats->objects.dependences,
+      &Stats->objects.locks};
+  for (int k = 0; k < NumObjects; k++) {
+    const archer_object_stats &O = *Objects[k];
+    printf("%-20s %14" PRIu64 " %14" PRIu64 " %14" PRIu64 "\n", ObjectNames[k],
+           O.count, O.peak_count, O.pooled_count);
+    printf("%-20s %14s %14s %14s\n", "", formatKB(O.bytes / 1024).c_str(),
+           formatKB(O.peak_bytes / 1024).c_str(),
+           formatKB(O.pooled_bytes / 1024).c_str());
+  }
+  fflush(stdout);
+}
+
+/// Process ids of all segments in /dev/shm.
+std::vector<int> findProcesses() {
+  std::vector<int> Pids;
+  DIR *Dir = opendir("/dev/shm");
+  if (!Dir)
+    return Pids;
+  while (struct dirent *Entry = readdir(Dir)) {
+    int Pid;
+    char End;
+    if (sscanf(Entry->d_name, "archer.%d%c", &Pid, &End) == 1)
+      Pids.push_back(Pid);
+  }
+  closedir(Dir);
+  return Pids;
+}
+
+const ArcherLiveStats *attach(int Pid) {
+  char Name[32];
+  snprintf(Name, sizeof(Name), ARCHER_STATS_NAME, Pid);
+  int Fd = shm_open(Name, O_RDONLY, 0);
+  if (Fd < 0) {
+    fprintf(stderr, "archer-top: no statistics for process %d, is it running "
+                    "with ARCHER_OPTIONS=live_stats=<ms>?\n", Pid);
+    return nullptr;
+  }
+  void *Addr = mmap(nullptr, sizeof(ArcherLiveStats), PROT_READ, MAP_SHARED,
+                    Fd, 0);
+  close(Fd);
+  if (Addr == MAP_FAILED) {
+    perror("archer-top: mmap");
+    return nullptr;
+  }
+  const ArcherLiveStats *Stats = (const ArcherLiveStats *)Addr;
+  // The runtime sets the magic last.
+  for (int i = 0; i < 100 && memcmp(Stats->magic, ARCHER_STATS_MAGIC,
+                                    sizeof(Stats->magic)); i++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  if (memcmp(Stats->magic, ARCHER_STATS_MAGIC, sizeof(Stats->magic)) ||
+      Stats->version != ARCHER_STATS_VERSION) {
+    fprintf(stderr, "archer-top: %s has an unknown format\n", Name);
+    return nullptr;
+  }
+  return Stats;
+}
+
+void usage() {
+  fprintf(stderr, "usage: archer-top [-d seconds] [-n iterations] [-b] [pid]\n");
+  exit(1);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  double Delay = 1;
+  long Iterations = -1;
+  bool Batch = false;
+  int Opt;
+  while ((Opt = getopt(argc, argv, "d:n:bh")) != -1) {
+    switch (Opt) {
+    case 'd':
+      Delay = atof(optarg);
+      break;
+    case 'n':
+      Iterations = atol(optarg);
+      break;
+    case 'b':
+      Batch = true;
+      break;
+    default:
+      usage();
+    }
+  }
+  if (optind + 1 < argc || Delay <= 0)
+    usage();
+
+  int Pid;
+  if (optind < argc) {
+    Pid = atoi(argv[optind]);
+  } else {
+    std::vector<int> Pids = findProcesses();
+    if (Pids.size() != 1) {
+      if (Pids.empty())
+        fprintf(stderr, "archer-top: no process runs with live statistics\n");
+      else {
+        fprintf(stderr, "archer-top: choose one of the processes:\n");
+        for (size_t i = 0; i < Pids.size(); i++)
+          fprintf(stderr, "  %d\n", Pids[i]);
+      }
+      return 1;
+    }
+    Pid = Pids[0];
+  }
+
+  const ArcherLiveStats *Stats = attach(Pid);
+  if (!Stats)
+    return 1;
+
+  Snapshot Prev;
+  bool HavePrev = false;
+  for (long i = 0; Iterations < 0 || i < Iterations; i++) {
+    if (i > 0)
+      std::this_thread::sleep_for(std::chrono::duration<double>(Delay));
+    Snapshot Now = takeSnapshot(Stats);
+    if (!Batch)
+      printf("\033[H\033[J");
+    else if (i > 0)
+      printf("\n");
+    print(Stats, Now, HavePrev ? &Prev : nullptr);
+    Prev = Now;
+    HavePrev = true;
+    // The segment of a killed process stays behind.
+    if (Stats->finished)
+      break;
+    if (kill(Pid, 0) != 0 && errno == ESRCH) {
+      fprintf(stderr, "archer-top: process %d has exited, remove /dev/shm"
+                      ARCHER_STATS_NAME "\n", Pid, Pid);
+      break;
+    }
+  }
+  return 0;
+}